@@ -30,7 +30,41 @@ extern "C" {
 
 typedef long TimerID_t;
 typedef long TimerBucketID_t;
+typedef long TimerCQID_t;
+typedef long AgerID_t;
 typedef void (*time_out_proc)(void* data);
+typedef void (*age_out_proc)(unsigned int idx, void* data);
+
+//expiry completion entry.
+typedef struct st_ltimer_cqe {
+	TimerID_t			id;				//timer id, a once timer is finished already.
+	void*				data;			//data given to add_timer_cq.
+} ltimer_cqe_t;
+
+//timer bucket flags.
+#define LTIMER_BKT_F_VIRTUAL	0x01	//virtual clock, no work thread, time moves only by bucket_advance.
+#define LTIMER_BKT_F_IOURING	0x02	//io_uring work thread instead of epoll, falls back to epoll if unavailable.
+#define LTIMER_BKT_F_HEAP		0x04	//4-ary min-heap timer queue instead of sorted list, O(log n) add/del.
+#define LTIMER_BKT_F_WHEEL		0x08	//hashed timing wheel of resolution sized slots, O(1) add/del, vector scan on expiry.
+#define LTIMER_BKT_F_SPREAD		0x10	//spread every cycle timer as with LTIMER_F_SPREAD.
+
+//timer flags, or'ed into type of add_timer.
+#define LTIMER_TYPE_FLAGS		0xfff0	//bits of type holding LTIMER_F_XXX.
+#define LTIMER_F_HIGHPRIO		0x0010	//high priority lane, fired before and between batches of other timers.
+#define LTIMER_F_SPREAD			0x0020	//random first phase and period jitter, refer to bucket_set_spread.
+#define LTIMER_F_PREFETCH_DATA	0x0040	//data points to memory func touches, prefetched ahead of firing.
+
+//timestamp formats of curtime_fmt.
+#define LTIMER_FMT_CTIME		0		//"Mon Oct 19 12:34:56 2026\n", local time, same as ctime.
+#define LTIMER_FMT_ISO_MS		1		//"2026-10-19T12:34:56.789Z", ISO-8601 UTC with ms.
+#define LTIMER_FMT_ISO_US		2		//"2026-10-19T12:34:56.789012Z", ISO-8601 UTC with us.
+#define LTIMER_FMT_HTTP			3		//"Mon, 19 Oct 2026 12:34:56 GMT", HTTP-date.
+#define LTIMER_FMT_NUM			4
+
+//timer node embedded in caller's memory (e.g. a coroutine frame), takes no slot from bucket pool.
+typedef struct st_ltimer_node {
+	long				opaque[16];
+} ltimer_node_t;
 
 //---------------------------------------------------------------------------------------
 //@function: create a timer bucket.
@@ -41,15 +75,28 @@ typedef void (*time_out_proc)(void* data);
 //@return: -1 on error, positive number on success.
 TimerBucketID_t create_timer_bucket(const char *name, int size, int cpuid, struct timespec resolution);
 
-//@function: destroy timer bucket.
+//@function: create a timer bucket with flags.
+//@param flags: refer to LTIMER_BKT_F_XXX, 0 behaves as create_timer_bucket.
+//@return: -1 on error, positive number on success.
+TimerBucketID_t create_timer_bucket_ex(const char *name, int size, int cpuid, struct timespec resolution, int flags);
+
+//@function: destroy timer bucket, work thread is woken up at once and joined.
 void destroy_timer_bucket(TimerBucketID_t bktid);
 
+//@function: change bucket settings in place, active timers are kept.
+//not to be called concurrently with itself or destroy_timer_bucket on the same bucket.
+//@param size: new max storage, 0 to keep, can only grow.
+//@param cpuid: cpu core id to rebind work thread to, -1 to keep, ignored by virtual bucket.
+//@param resolution: new resolution, 0 to keep. wheel bucket keeps slot width of creation.
+//@return: -1 on error, 0 on success.
+int reconfigure_timer_bucket(TimerBucketID_t bktid, int size, int cpuid, struct timespec resolution);
+
 //@function : add timer to timer bucket.
 //@param bktid: the timer bucket to add.
 //@param tm: relative time to timeout.
 //@param func: callback func when timeout.
 //@param data: data for callback.
-//@param type: 0 - once timer; 1 - cycle timer.
+//@param type: 0 - once timer; 1 - cycle timer, or'ed with LTIMER_F_XXX.
 //@return: -1 on error, positive number on success.
 TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc func, void *data, int type);
 
@@ -60,17 +107,164 @@ TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc fun
 //@return: -1 on error, 0 on success.
 int mod_timer(TimerID_t timerid, struct timespec tm, time_out_proc func, void *data);
 
-//@function: delete timer by ID.
+//@function: delete timer by ID, lock-free and callable from any thread.
+//func won't be called after return, except a call already running on work thread.
 //@return: -1 on error, 0 on success.
 int del_timer(TimerID_t timerid);
 
+//@function: delete timer by ID, and wait for a call of func running on work thread to finish.
+//doesn't wait when called from a callback of the same bucket.
+//timer added by add_timer_node is deleted as by del_timer_node.
+//@return: -1 on error, 0 on success.
+int del_timer_sync(TimerID_t timerid);
+
+//@function : add once timer using caller owned node, no pool slot and no allocation.
+//@param node: node memory, must stay valid until timeout or del_timer_node returns.
+//@return: -1 on error, positive number on success.
+TimerID_t add_timer_node(TimerBucketID_t bktid, ltimer_node_t *node, struct timespec tm, time_out_proc func, void *data);
+
+//@function: delete node timer synchronously, func won't be called and node can be released after return.
+//@return: -1 on error, 0 on success.
+int del_timer_node(TimerID_t timerid);
+
+//---------------------------------------------------------------------------------------
+//@function: stage add_timer/mod_timer/del_timer of calling thread instead of posting each one.
+//staged ops of a timer are coalesced: add then del cancel out, mods fold into the op before them.
+//they are posted with one pipe write per bucket when threshold ops are staged, on ltimer_flush,
+//ltimer_batch_stop or thread exit, and take effect from then on. ops on virtual buckets and
+//timer nodes are never staged. flush before destroying a bucket with staged ops.
+//@param threshold: number of staged ops to flush at, 1 to 64, may be called again to change it.
+//@return: -1 on error, 0 on success.
+int ltimer_batch_start(int threshold);
+
+//@function: flush staged ops and stop staging on calling thread.
+//@return: -1 if ops of some bucket are lost, 0 on success.
+int ltimer_batch_stop(void);
+
+//@function: post ops staged by calling thread.
+//while pipe of a bucket is full the flush waits for work thread to drain it, a callback on work
+//thread drains it itself. ops are lost only if the bucket is stopping or the write fails for good:
+//timers added by lost ops are cancelled and never fire, their slots are not reused until the bucket
+//is destroyed, lost mods and dels have no effect. a flush at threshold reports loss on next flush.
+//@return: -1 if ops of some bucket are lost since last flush, 0 on success.
+int ltimer_flush(void);
+
+//---------------------------------------------------------------------------------------
+//@function: create an expiry completion queue of a bucket, for timers delivered to one consumer
+//thread instead of calling back on work thread.
+//@param size: entries of ring, rounded up to power of 2. expiries finding the ring full are retried next tick.
+//@return: -1 on error, positive number on success.
+TimerCQID_t create_timer_cq(TimerBucketID_t bktid, int size);
+
+//@function: destroy completion queue, no timer added to it may be pending.
+void destroy_timer_cq(TimerCQID_t cqid);
+
+//@function: get eventfd of completion queue, readable once an entry lands in the empty ring.
+//@return: -1 on error, fd on success.
+int timer_cq_fd(TimerCQID_t cqid);
+
+//@function: add timer to bucket of a completion queue, expiry puts id and data into the queue.
+//@param type: same as add_timer.
+//@return: -1 on error, positive number on success.
+TimerID_t add_timer_cq(TimerCQID_t cqid, struct timespec tm, void *data, int type);
+
+//@function: take expired timers from completion queue, only one thread may drain a queue.
+//eventfd is cleared, so call again when max entries are returned.
+//@return: -1 on error, number of entries on success.
+int drain_timer_cq(TimerCQID_t cqid, ltimer_cqe_t *cqes, int max);
+
+//---------------------------------------------------------------------------------------
+//@function: create an epoch aging engine in a bucket, for many entries with a coarse common timeout.
+//an entry costs one byte and is armed or refreshed by a single store from any thread, no timer,
+//no pipe traffic. a cycle timer of the bucket sweeps out entries of the expired epoch once an epoch.
+//an entry ages out (nepochs - 1, nepochs] epochs after it was last armed.
+//@param capacity: number of entries, indexed from 0.
+//@param epoch: length of an epoch.
+//@param nepochs: epochs an entry lives, 2 to 253.
+//@param func: callback of aged out entry, called on bucket work thread.
+//@return: -1 on error, positive number on success.
+AgerID_t create_ager(TimerBucketID_t bktid, unsigned int capacity, struct timespec epoch, int nepochs,
+					 age_out_proc func, void *data);
+
+//@function: stop sweeping and free aging engine.
+void destroy_ager(AgerID_t agerid);
+
+//@function: arm or refresh an entry in current epoch, a plain byte store safe from any thread.
+//an entry refreshed while being swept either ages out or stays, never both.
+//@return: -1 on error, 0 on success.
+int ager_arm(AgerID_t agerid, unsigned int idx);
+
+//@function: disarm an entry, it won't age out.
+//@return: -1 on error, 0 on success.
+int ager_disarm(AgerID_t agerid, unsigned int idx);
+
+//---------------------------------------------------------------------------------------
+//@function: advance clock of a virtual bucket, fire expired timers on caller thread.
+//virtual clock starts at 0, add/mod/del on a virtual bucket are applied at once on caller thread.
+//@param tm: relative time to advance, remainder less than resolution is carried to next call.
+//each tick is bounded by bucket_set_budget as a wakeup, on a left over the clock stops and the rest
+//of time is carried too, next call fires the left over first, advance 0 to just fire it.
+//@return: -1 on error, number of timers fired on success.
+int bucket_advance(TimerBucketID_t bktid, struct timespec tm);
+
+//@function: get current time of a bucket, the virtual clock for virtual bucket.
+const struct timespec* bucket_curtime(TimerBucketID_t bktid, struct timespec* pts);
+
+//@function: bound the work done firing timers per wakeup of work thread, so timer ops posted
+//meanwhile are taken between rounds of a bulk expiry. expired timers left over are fired
+//right after pending ops, without waiting for next tick. high priority lane is never held back.
+//a virtual bucket is bounded per tick of bucket_advance, see there.
+//@param count: max timers fired per wakeup, 0 for no limit.
+//@param tm: max time firing timers per wakeup, checked every 64 timers, 0 for no limit.
+//@return: -1 on error, 0 on success.
+int bucket_set_budget(TimerBucketID_t bktid, int count, struct timespec tm);
+
+//@function: set bounds of spreading for LTIMER_F_SPREAD timers, both are clamped to period of timer.
+//first timeout is delayed by a uniform random time in [0, phase), every later period gets a uniform
+//random jitter in [-jitter / 2, jitter / 2), so timers added together don't keep firing in one tick.
+//@param phase: bound of first phase, 0 for one period (default).
+//@param jitter: bound of jitter per period, 0 for none (default).
+//@return: -1 on error, 0 on success.
+int bucket_set_spread(TimerBucketID_t bktid, struct timespec phase, struct timespec jitter);
+
+//@function: get deadline of next timer in bucket, lock-free, as of last tick.
+//the first query of a bucket turns publishing on, work thread publishes from its next tick on,
+//until then queries from other threads fail with errno EAGAIN.
+//@param pts: abs time in bucket clock.
+//@return: -1 on error or not ready yet, 0 if no timer pending, 1 if pts is set.
+int bucket_next_expiry(TimerBucketID_t bktid, struct timespec *pts);
+
+//@function: count timers expiring within window from now, lock-free, read from a summary
+//recounted at most once per slot width (bucket resolution, at least 4 ms).
+//window is rounded up to slot width and clamped to 256 slots, not ready as bucket_next_expiry.
+//@return: -1 on error or not ready yet, number of timers on success.
+long bucket_count_expiring(TimerBucketID_t bktid, struct timespec window);
+
+//@function: start recording add/mod/del/expire operations of a bucket into a binary trace file.
+//records go through a lock-free ring flushed by work thread every tick, replay with ltimer-replay.
+//@return: -1 on error, 0 on success.
+int bucket_record_start(TimerBucketID_t bktid, const char *path);
+
+//@function: stop recording, flush and close trace file.
+//@return: -1 on error, number of records dropped on full ring on success.
+long bucket_record_stop(TimerBucketID_t bktid);
+
 //---------------------------------------------------------------------------------------
 //@function: get current time.
 const struct timespec* curtime(struct timespec* pts);
 
-//@function: get current time str representation.
+//@function: get current time str representation, same as ctime.
+//@param size: size of timestr, string is truncated to fit.
+//@return: NULL on error, timestr on success.
 const char* curtime_str(char *timestr, int size);
 
+//@function: copy current time of a bucket formatted, strings are rendered by bucket work thread
+//when the visible value changes, so this is a plain copy, safe to call from any thread.
+//@param fmt: refer to LTIMER_FMT_XXX.
+//@param size: size of buf, string is truncated to fit.
+//@return: -1 on error, length of string on success.
+int curtime_fmt(TimerBucketID_t bktid, int fmt, char *buf, int size);
+
 #ifdef __cplusplus
 }
 #endif
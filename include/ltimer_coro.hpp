@@ -0,0 +1,206 @@
+#ifndef LTIMER_CORO_HPP
+#define LTIMER_CORO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "ltimer.h"
+
+//C++20 coroutine awaitables on top of timer buckets.
+//
+//The timer node lives in the awaiter, so in the coroutine frame: no pool slot, no allocation.
+//Resumption is done on the bucket work thread (inline_executor) or handed to a user executor,
+//which is any copyable type with member `void post(std::coroutine_handle<>)`.
+//Destroying a frame suspended on a timer cancels the timer synchronously.
+//
+//  co_await ltimer::sleep_for(bktid, 5ms);
+//  auto n = co_await ltimer::with_deadline(bktid, read_op, 2s);
+
+namespace ltimer {
+
+struct inline_executor {
+	void post(std::coroutine_handle<> h) const { h.resume(); }
+};
+
+inline struct timespec to_timespec(std::chrono::nanoseconds d)
+{
+	struct timespec ts;
+	ts.tv_sec = (time_t)(d.count() / 1000000000);
+	ts.tv_nsec = (long)(d.count() % 1000000000);
+	return ts;
+}
+
+//---------------------------------------------------------------------------------------
+template <typename Executor = inline_executor>
+class sleep_awaiter {
+public:
+	sleep_awaiter(TimerBucketID_t bktid, std::chrono::nanoseconds d, Executor ex)
+		: bktid_(bktid), duration_(d), ex_(std::move(ex)) {}
+
+	sleep_awaiter(const sleep_awaiter&) = delete;
+	sleep_awaiter& operator=(const sleep_awaiter&) = delete;
+
+	~sleep_awaiter()
+	{
+		if (-1 != id_ && !fired_.load(std::memory_order_acquire)) {
+			del_timer_node(id_);
+		}
+	}
+
+	bool await_ready() const noexcept { return duration_.count() <= 0; }
+
+	//@return: false to resume at once when timer can't be added.
+	bool await_suspend(std::coroutine_handle<> h)
+	{
+		handle_ = h;
+		id_ = add_timer_node(bktid_, &node_, to_timespec(duration_), &sleep_awaiter::on_timeout, this);
+		return -1 != id_;
+	}
+
+	//@return: true if slept, false if timer could not be added.
+	bool await_resume() const noexcept { return await_ready() || fired_.load(std::memory_order_acquire); }
+
+private:
+	static void on_timeout(void *data)
+	{
+		sleep_awaiter *self = static_cast<sleep_awaiter *>(data);
+		//frame may be gone once posted, copy what we need first.
+		Executor ex = self->ex_;
+		std::coroutine_handle<> h = self->handle_;
+		self->fired_.store(true, std::memory_order_release);
+		ex.post(h);
+	}
+
+	ltimer_node_t				node_;
+	TimerBucketID_t				bktid_;
+	TimerID_t					id_ = -1;
+	std::chrono::nanoseconds	duration_;
+	Executor					ex_;
+	std::coroutine_handle<>		handle_;
+	std::atomic<bool>			fired_{false};
+};
+
+template <typename Rep, typename Period>
+sleep_awaiter<> sleep_for(TimerBucketID_t bktid, std::chrono::duration<Rep, Period> d)
+{
+	return sleep_awaiter<>(bktid, std::chrono::duration_cast<std::chrono::nanoseconds>(d), inline_executor());
+}
+
+template <typename Rep, typename Period, typename Executor>
+sleep_awaiter<Executor> sleep_for(TimerBucketID_t bktid, std::chrono::duration<Rep, Period> d, Executor ex)
+{
+	return sleep_awaiter<Executor>(bktid, std::chrono::duration_cast<std::chrono::nanoseconds>(d), std::move(ex));
+}
+
+//---------------------------------------------------------------------------------------
+//Awaits op, calling op.cancel() on the bucket work thread if it has not completed by the deadline.
+//The op is expected to complete promptly after cancel() and report cancellation in its own result.
+//Its await_suspend must not resume the coroutine itself (return false instead) nor wait on the
+//work thread: a deadline passing meanwhile holds cancel() back until await_suspend has returned.
+//Throws std::runtime_error from co_await if the deadline timer can't be added, op is not started then.
+template <typename Awaitable>
+concept cancellable_awaitable = requires(Awaitable& a) {
+	a.await_ready();
+	a.await_resume();
+	a.cancel();
+};
+
+template <cancellable_awaitable Awaitable>
+class deadline_awaiter {
+	enum { PHASE_IDLE, PHASE_SUSPENDING, PHASE_SUSPENDED };
+
+public:
+	deadline_awaiter(TimerBucketID_t bktid, Awaitable&& op, std::chrono::nanoseconds d)
+		: op_(std::forward<Awaitable>(op)), bktid_(bktid), duration_(d) {}
+
+	deadline_awaiter(const deadline_awaiter&) = delete;
+	deadline_awaiter& operator=(const deadline_awaiter&) = delete;
+
+	~deadline_awaiter() { disarm(); }
+
+	bool await_ready() { return op_.await_ready(); }
+
+	//timer is armed first, once op is suspended the frame may be resumed and gone at any time.
+	template <typename Promise>
+	auto await_suspend(std::coroutine_handle<Promise> h)
+	{
+		phase_.store(PHASE_SUSPENDING, std::memory_order_relaxed);
+		id_ = add_timer_node(bktid_, &node_, to_timespec(std::max(duration_, std::chrono::nanoseconds(1))),
+							 &deadline_awaiter::on_timeout, this);
+		if (-1 == id_) {
+			phase_.store(PHASE_IDLE, std::memory_order_relaxed);
+			throw std::runtime_error("ltimer: deadline timer can't be added");
+		}
+		//storing phase is the last touch of awaiter on this thread.
+		if constexpr (std::is_void_v<decltype(op_.await_suspend(h))>) {
+			op_.await_suspend(h);
+			phase_.store(PHASE_SUSPENDED, std::memory_order_release);
+		} else {
+			auto ret = op_.await_suspend(h);
+			phase_.store(PHASE_SUSPENDED, std::memory_order_release);
+			return ret;
+		}
+	}
+
+	decltype(auto) await_resume()
+	{
+		//op completed on another thread, suspending thread may still be on its way out of await_suspend.
+		wait_suspended();
+		disarm();
+		return op_.await_resume();
+	}
+
+	bool timed_out() const noexcept { return fired_.load(std::memory_order_acquire); }
+
+private:
+	static void on_timeout(void *data)
+	{
+		deadline_awaiter *self = static_cast<deadline_awaiter *>(data);
+		self->fired_.store(true, std::memory_order_release);
+		//op may not be suspended yet, cancel it once it is.
+		self->wait_suspended();
+		//op may resume and release the frame inline, don't touch self afterwards.
+		self->op_.cancel();
+	}
+
+	void wait_suspended() const noexcept
+	{
+		while (PHASE_SUSPENDING == phase_.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+
+	//waits out a concurrently running on_timeout, so op stays valid while it's cancelled.
+	void disarm()
+	{
+		if (-1 != id_) {
+			del_timer_node(id_);
+			id_ = -1;
+		}
+	}
+
+	Awaitable					op_;
+	ltimer_node_t				node_;
+	TimerBucketID_t				bktid_;
+	TimerID_t					id_ = -1;
+	std::chrono::nanoseconds	duration_;
+	std::atomic<bool>			fired_{false};
+	std::atomic<int>			phase_{PHASE_IDLE};
+};
+
+template <typename Awaitable, typename Rep, typename Period>
+deadline_awaiter<Awaitable> with_deadline(TimerBucketID_t bktid, Awaitable&& op, std::chrono::duration<Rep, Period> d)
+{
+	return deadline_awaiter<Awaitable>(bktid, std::forward<Awaitable>(op),
+									   std::chrono::duration_cast<std::chrono::nanoseconds>(d));
+}
+
+} //namespace ltimer
+
+#endif //LTIMER_CORO_HPP
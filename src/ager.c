@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ltimer.h"
+
+//epoch aging engine.
+//an entry is one byte holding the epoch it was last armed in, 0 when unused.
+//a cycle timer of the bucket advances the epoch, then sweeps the whole array once with memchr
+//for the epoch going out of window, each hit is cleared by CAS so a concurrent refresh wins.
+//epochs run 1..255, an entry ages out nepochs epochs after its stamp, long before its value comes back.
+
+#define AGER_EPOCHS		255
+
+typedef struct st_ager {
+	uint8_t*			stamps;			//epoch stamp per entry.
+	unsigned int		capacity;		//number of entries.
+	int					nepochs;		//epochs an entry lives.
+	volatile uint8_t	epoch;			//current epoch, 1..255.
+	age_out_proc		func;			//callback of aged out entry.
+	void*				data;			//data for callback.
+	TimerID_t			timer;			//epoch timer in bucket.
+} ager_t;
+
+//@return: epoch n epochs before cur, in 1..255.
+static inline uint8_t epoch_before(uint8_t cur, int n)
+{
+	return (uint8_t)(((cur - 1 - n) % AGER_EPOCHS + AGER_EPOCHS) % AGER_EPOCHS + 1);
+}
+
+static void ager_sweep(void *data)
+{
+	ager_t *p_ager = (ager_t *)data;
+	uint8_t cur = epoch_before(p_ager->epoch, -1);
+	uint8_t old = epoch_before(cur, p_ager->nepochs);
+	uint8_t expect;
+	uint8_t *p = p_ager->stamps;
+	uint8_t *end = p_ager->stamps + p_ager->capacity;
+
+	__atomic_store_n(&p_ager->epoch, cur, __ATOMIC_RELAXED);
+	while (p < end && NULL != (p = (uint8_t *)memchr(p, old, end - p))) {
+		expect = old;
+		if (__atomic_compare_exchange_n(p, &expect, 0, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			p_ager->func((unsigned int)(p - p_ager->stamps), p_ager->data);
+		}
+		p++;
+	}
+}
+
+AgerID_t create_ager(TimerBucketID_t bktid, unsigned int capacity, struct timespec epoch, int nepochs,
+					 age_out_proc func, void *data)
+{
+	if (bktid == 0 || 0 == capacity || nepochs < 2 || nepochs >= AGER_EPOCHS - 1
+		|| epoch.tv_sec < 0 || epoch.tv_nsec < 0 || (epoch.tv_sec == 0 && epoch.tv_nsec == 0)
+		|| NULL == func) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	ager_t *p_ager = (ager_t *)calloc(sizeof(ager_t), 1);
+	if (NULL == p_ager) {
+		printf("%s: calloc failed!\n", __func__);
+		return -1;
+	}
+	p_ager->stamps = (uint8_t *)calloc(1, capacity);
+	if (NULL == p_ager->stamps) {
+		printf("%s: calloc failed!\n", __func__);
+		free(p_ager);
+		return -1;
+	}
+	p_ager->capacity = capacity;
+	p_ager->nepochs = nepochs;
+	p_ager->epoch = 1;
+	p_ager->func = func;
+	p_ager->data = data;
+
+	p_ager->timer = add_timer(bktid, epoch, ager_sweep, p_ager, 1);
+	if (-1 == p_ager->timer) {
+		free(p_ager->stamps);
+		free(p_ager);
+		return -1;
+	}
+	return (AgerID_t)p_ager;
+}
+
+void destroy_ager(AgerID_t agerid)
+{
+	ager_t *p_ager = (ager_t *)agerid;
+	if (NULL == p_ager) {
+		return;
+	}
+	del_timer_sync(p_ager->timer);
+	free(p_ager->stamps);
+	free(p_ager);
+}
+
+int ager_arm(AgerID_t agerid, unsigned int idx)
+{
+	ager_t *p_ager = (ager_t *)agerid;
+	if (NULL == p_ager || idx >= p_ager->capacity) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	__atomic_store_n(&p_ager->stamps[idx], __atomic_load_n(&p_ager->epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	return 0;
+}
+
+int ager_disarm(AgerID_t agerid, unsigned int idx)
+{
+	ager_t *p_ager = (ager_t *)agerid;
+	if (NULL == p_ager || idx >= p_ager->capacity) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	__atomic_store_n(&p_ager->stamps[idx], 0, __ATOMIC_RELAXED);
+	return 0;
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 
 #define _POSIX_C_SOURCE_ 199309
@@ -11,56 +12,164 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/time.h>
+#include <poll.h>
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
 
 #include "list_head.h"
+#include "probes.h"
+#include "recorder.h"
+#include "timer_cq.h"
+#include "timer_queue.h"
+#include "uring.h"
 #include "utils.h"
 
 #include "ltimer.h"
 
 #define MAX_EVENT_NUMBER	8
+#define OPT_READ_BATCH		64		//timer events got by one read of pipe.
+#define URING_ENTRIES		8
+#define URING_OPT_RING		1024	//timer events queued for io_uring worker, power of 2.
+#define EXPIRE_LO_BATCH		64		//low priority timers fired between checks of high priority lane.
+#define EXPIRE_BATCH		64		//timers popped before firing them.
+#define EXPIRE_PREFETCH		8		//timers prefetched ahead of the one fired.
+
+//io_uring completion tags.
+enum {
+	EN_URING_UD_PIPE = 1,
+	EN_URING_UD_TICK,
+};
 
 enum {
 	EN_TIMER_OPT_ADD,
 	EN_TIMER_OPT_DEL,
 	EN_TIMER_OPT_MOD,
+	EN_TIMER_OPT_DEL_SYNC,
+	EN_TIMER_OPT_RECONF,
+	EN_TIMER_OPT_STOP,
 };
 
+//ltimer_t flags.
+#define TIMER_F_EXTERN		0x01	//node memory owned by caller, never recycled into pool.
+#define TIMER_F_HIGHPRIO	0x02	//queued in high priority lane.
+#define TIMER_F_SPREAD		0x04	//random first phase and period jitter.
+#define TIMER_F_CQ			0x08	//expiry delivered to completion queue instead of func.
+#define TIMER_F_PREFETCH	0x10	//prefetch data before firing.
+
+//ltimer_t state bits, 0 is armed, changed by CAS only.
+#define TIMER_ST_CANCELLED	0x01	//cancelled, func won't run again, unlinked when work thread meets it.
+#define TIMER_ST_RUNNING	0x02	//func is running on work thread.
+#define TIMER_ST_DONE		0x04	//once timer fired.
+
 typedef struct st_ltimer_opt {
 	int					opt;		//refer to EN_TIMER_OPT_XXX.
 	int					pad;		//padding bytes.
 	TimerID_t			id;			//timer id.
-	struct timespec		period;		//period time.
+	struct timespec		period;		//period time, first timeout of ADD if set by folded mods.
 	time_out_proc		func;		//callback func when timeout.
 	void *				data;		//data for callback.
 } ltimer_opt_t;
 
 typedef struct st_ltimer {
-	struct list_head	entry;		//list head entry.
+	tq_node_t			node;		//timer queue node, node.key is expire time, use abs time in ns.
 
 	void *				p_bkt;		//relate to timer bucket.
 
 	struct timespec		period;		//period time.
-	struct timespec		expire;		//expire time, use abs time.
 	time_out_proc		func;		//callback func when timeout.
 	void *				data;		//data for callback.
 
 	int					type;		//cycle(1) or once(0) timer.
+	int					flags;		//refer to TIMER_F_XXX.
+	volatile int		state;		//refer to TIMER_ST_XXX.
 	int					pad;		//padding bytes.
+
+	timer_cq_t*			cq;			//completion queue of TIMER_F_CQ timer.
 } ltimer_t;
 
+_Static_assert(sizeof(ltimer_t) <= sizeof(ltimer_node_t), "ltimer_node_t is too small to hold ltimer_t");
+
+//header of pool memory, timers follow it. chunks are added by growing, released on destroy only.
+typedef struct st_pool_chunk {
+	struct st_pool_chunk*	next;		//earlier chunk.
+	int64_t					pad;		//padding bytes.
+} pool_chunk_t;
+
+//reconfiguration applied by work thread, waited for by caller.
+typedef struct st_bucket_reconf {
+	struct timespec		resolution;		//new tick, 0 to keep.
+	int					cpuid;			//core to bind, -1 to keep.
+	int					result;			//-1 on error, 0 on success.
+	volatile int		done;			//set by work thread when applied.
+} bucket_reconf_t;
+
+//io_uring worker state, timer events come through a shared ring, pipe only wakes a sleeping worker.
+typedef struct st_uring_worker {
+	uring_t					ring;			//ring for doorbell read and its tick timeout.
+	struct __kernel_timespec	next_tick;		//abs time of next tick timeout.
+	char					dbuf[64];		//doorbell bytes of pipe read.
+	int						read_armed;		//doorbell read in flight.
+	int						tick_armed;		//tick timeout linked to doorbell read in flight.
+	int						tick_flags;		//timeout flags, relative timeout if abs realtime unsupported.
+	volatile int			idle;			//worker is going to sleep, next producer rings doorbell.
+	pthread_spinlock_t		olock;			//serializes producers of opts.
+	volatile unsigned		ohead;			//next event to apply, moved by worker only.
+	volatile unsigned		otail;			//next free slot, moved by producers under olock.
+	ltimer_opt_t			opts[URING_OPT_RING];	//events queued for worker.
+} uring_worker_t;
+
+#define TIMESTR_SIZE		40		//max length of a cached timestamp string.
+
+//timestamp strings of a bucket, rendered by the owner of bucket clock when visible value changes.
+//writer renders into buf[(seq + 1) & 1] then bumps seq, readers copy buf[seq & 1] and retry if seq moved.
+typedef struct st_timestr_cache {
+	volatile unsigned	seq;								//publish count.
+	int					len[2][LTIMER_FMT_NUM];				//string length.
+	int64_t				key[2][LTIMER_FMT_NUM];				//rendered value in unit of format, -1 if none.
+	char				str[2][LTIMER_FMT_NUM][TIMESTR_SIZE];
+} timestr_cache_t;
+
+#define SUMMARY_SLOTS		256		//slots of expiry summary.
+#define SUMMARY_MIN_WIDTH	4000000	//min slot width of expiry summary in ns.
+
+//expiry summary published by owner of bucket clock for lock-free queries, seqlock protected.
+//head deadline is refreshed every tick, slot counts at most once per slot width.
+typedef struct st_expiry_summary {
+	volatile unsigned	seq;					//odd while being written, 0 before first publish.
+	volatile int		wanted;					//set by first query, nothing is published before.
+	int64_t				now;					//bucket time of last publish.
+	int64_t				head;					//deadline of next timer, INT64_MAX if none.
+	int64_t				base;					//bucket time slot counts start from.
+	int64_t				width;					//slot width in ns, follows bucket resolution.
+	int64_t				next_count;				//bucket time to recount slots at.
+	int					count[SUMMARY_SLOTS];	//timers expiring before base + (i + 1) * width.
+} expiry_summary_t;
+
+//ops staged by a thread, one write per bucket on flush.
+typedef struct st_opt_batch {
+	int					count;			//staged ops.
+	int					threshold;		//flush when count reaches it.
+	int					lost;			//ops lost by a flush not reported yet.
+	int					pad;			//padding bytes.
+	struct st_timer_bucket*	bkts[OPT_READ_BATCH];	//bucket of each op.
+	ltimer_opt_t		optev[OPT_READ_BATCH];	//at most one op per timer.
+} opt_batch_t;
+
 typedef struct st_timer_bucket {
-	struct list_head	active_list;	//active timer list head entry.
+	timer_queue_t		tq;				//active timers ordered by expire time.
+	timer_queue_t		tq_hi;			//active high priority timers, always a heap.
 	struct list_head	recycle_list;	//dead timer list head entry.
 
-	char*				mem_alloc_ptr;	//memory ptr for final release.
+	pool_chunk_t*		chunks;			//pool memory, latest chunk first, for final release.
 	char*				cur_alloc_ptr;	//memory ptr for next allocation.
+	char*				end_alloc_ptr;	//end of latest chunk.
 
-	pthread_spinlock_t	splock;			//lock for recycle_list and cur_alloc_ptr.
+	pthread_spinlock_t	splock;			//lock for recycle_list and alloc ptrs.
 
 	struct timespec		curtime;		//system time, update every tick.
+	volatile int64_t	curtime_ns;		//curtime in ns, for threads other than owner of bucket clock.
 	struct timespec		resolution;		//tick, resolution for timer bucket.
 
 	pthread_t			thread_id;		//work thread id.
@@ -73,11 +182,44 @@ typedef struct st_timer_bucket {
 	int					size;			//bucket max size.
 	int					count;			//current timer count in bucket.
 	int					cpuid;			//core id to bind.
-	int					trigger;		//control working thread.
+	volatile int		trigger;		//control working thread.
+	int					flags;			//refer to LTIMER_BKT_F_XXX.
+	int					carry;			//expired timers left by budget, fired on an immediate re-loop.
+
+	int					budget_count;	//max timers fired per wakeup, 0 for no limit.
+	int					pad;			//padding bytes.
+	int64_t				budget_ns;		//max time spent firing timers per wakeup, 0 for no limit.
+
+	uint64_t			prng;			//xorshift state for spreading, used by owner of bucket clock only.
+	int64_t				spread_phase;	//bound of random first phase in ns, 0 for one period.
+	int64_t				spread_jitter;	//bound of random jitter per period in ns, 0 for none.
+
+	int64_t				vclock_frac;	//virtual clock, advanced time not yet making up a whole tick.
+
+	ltimer_t*			expiring[EXPIRE_BATCH];	//timers popped and not fired yet, NULL if released meanwhile.
+	int					nexpiring;		//number of entries in expiring.
+	int					pad2;			//padding bytes.
+
+	recorder_t*			recorder;		//workload recorder, created on first bucket_record_start.
+	uring_worker_t*		uring;			//io_uring worker state, NULL for epoll worker.
+
+	timestr_cache_t		timestr;		//timestamp strings of curtime.
+	expiry_summary_t	summary;		//expiry summary for bucket_next_expiry/bucket_count_expiring.
 } timer_bucket_t;
 
 struct timespec g_sys_curtime;	//system real time, can be used by other module with efficiency.
 
+static __thread opt_batch_t* t_batch;	//staging of calling thread, NULL when not batching.
+static pthread_key_t g_batch_key;		//flushes staged ops at thread exit.
+static pthread_once_t g_batch_once = PTHREAD_ONCE_INIT;
+
+LTIMER_PROBE_SEMAPHORE(add);
+LTIMER_PROBE_SEMAPHORE(mod);
+LTIMER_PROBE_SEMAPHORE(del);
+LTIMER_PROBE_SEMAPHORE(opt_batch);
+LTIMER_PROBE_SEMAPHORE(fire);
+LTIMER_PROBE_SEMAPHORE(tick);
+
 static int add_epoll_event(int fd, int event, int epollfd)
 {
 	struct epoll_event ev;
@@ -86,341 +228,1461 @@ static int add_epoll_event(int fd, int event, int epollfd)
 	return epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
-static inline int compare_timespec(struct timespec t1, struct timespec t2)
+static inline int64_t timespec_to_ns(struct timespec ts)
 {
-	if (t1.tv_sec != t2.tv_sec) {
-		return (t1.tv_sec - t2.tv_sec);
-	} else {
-		return (t1.tv_nsec - t2.tv_nsec);
+	return ((int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+static inline struct timespec timespec_add(struct timespec t1, struct timespec t2)
+{
+	struct timespec ts;
+	ts.tv_sec = t1.tv_sec + t2.tv_sec;
+	ts.tv_nsec = t1.tv_nsec + t2.tv_nsec;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000;
 	}
+	return ts;
 }
 
 static void update_curtime(struct timespec* cur, struct timespec* tick, uint64_t nex)
 {
 	cur->tv_sec += (nex * tick->tv_sec);
 	cur->tv_nsec += (nex * tick->tv_nsec);
-	while (cur->tv_nsec > 1000000000) {
+	while (cur->tv_nsec >= 1000000000) {
 		cur->tv_sec += 1;
 		cur->tv_nsec -= 1000000000;
 	}
+}
 
+//@function: move bucket clock by nex ticks, called by owner of bucket clock.
+static inline void advance_curtime(timer_bucket_t *p_bkt, uint64_t nex)
+{
+	update_curtime(&p_bkt->curtime, &p_bkt->resolution, nex);
+	__atomic_store_n(&p_bkt->curtime_ns, timespec_to_ns(p_bkt->curtime), __ATOMIC_RELAXED);
+}
+
+static void publish_curtime(struct timespec* cur)
+{
 	__sync_lock_test_and_set(&g_sys_curtime.tv_sec, cur->tv_sec);
 	__sync_lock_test_and_set(&g_sys_curtime.tv_nsec, cur->tv_nsec);
 }
 
-static inline int compare_timer_by_entry(list_head_t* ptr1, list_head_t* ptr2)
+static const char *g_wday_name[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char *g_mon_name[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+									 "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+//@return: value of ts visible in format fmt.
+static inline int64_t timestr_key(int fmt, struct timespec ts)
 {
-	ltimer_t* p_timer1 = list_entry(ptr1, ltimer_t, entry);
-	ltimer_t* p_timer2 = list_entry(ptr2, ltimer_t, entry);
-	return compare_timespec(p_timer1->expire, p_timer2->expire);
+	switch (fmt) {
+	case LTIMER_FMT_ISO_MS:
+		return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	case LTIMER_FMT_ISO_US:
+		return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	default:
+		return (int64_t)ts.tv_sec;
+	}
 }
 
-static void check_timers_in_bucket(timer_bucket_t *p_bkt)
+//@return: length of string.
+static int render_timestr(char *str, int fmt, struct timespec ts, struct tm *p_utc)
 {
-	ltimer_t *pos, *n;
-	list_for_each_entry_safe(pos, n, &p_bkt->active_list, entry) {
-		if (compare_timespec(p_bkt->curtime, pos->expire) < 0) {
-			return;
-		}
+	time_t sec = (time_t)ts.tv_sec;
 
-		//already timeout, call proc func.
-		pos->func(pos->data);
-
-		//once timer, remove from active list and recycle.
-		//cycle timer, remove from active list, setup time, insert into active list again.
-		if (0 == pos->type) {
-			list_del(&pos->entry);
-			list_add_tail(&pos->entry, &p_bkt->recycle_list);
-		} else {
-			list_del(&pos->entry);
-			pos->expire.tv_sec = p_bkt->curtime.tv_sec + pos->period.tv_sec;
-			pos->expire.tv_nsec = p_bkt->curtime.tv_nsec + pos->period.tv_nsec;
-			list_insert_reverse(&pos->entry, &p_bkt->active_list, compare_timer_by_entry, 1);
+	switch (fmt) {
+	case LTIMER_FMT_CTIME:
+		if (NULL == ctime_r(&sec, str)) {
+			str[0] = '\0';
 		}
+		return (int)strlen(str);
+	case LTIMER_FMT_ISO_MS:
+		return snprintf(str, TIMESTR_SIZE, "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ",
+						p_utc->tm_year + 1900, p_utc->tm_mon + 1, p_utc->tm_mday,
+						p_utc->tm_hour, p_utc->tm_min, p_utc->tm_sec, ts.tv_nsec / 1000000);
+	case LTIMER_FMT_ISO_US:
+		return snprintf(str, TIMESTR_SIZE, "%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ",
+						p_utc->tm_year + 1900, p_utc->tm_mon + 1, p_utc->tm_mday,
+						p_utc->tm_hour, p_utc->tm_min, p_utc->tm_sec, ts.tv_nsec / 1000);
+	default:
+		//HTTP-date names are fixed english, not locale dependent.
+		return snprintf(str, TIMESTR_SIZE, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+						g_wday_name[p_utc->tm_wday], p_utc->tm_mday, g_mon_name[p_utc->tm_mon],
+						p_utc->tm_year + 1900, p_utc->tm_hour, p_utc->tm_min, p_utc->tm_sec);
 	}
 }
 
-static void proc_timer_opt_event(int pipefd, timer_bucket_t *p_bkt)
+static void init_timestr(timestr_cache_t *p_cache)
 {
-	int nread = 0;
-	ltimer_opt_t optev;
-	ltimer_t* p_timer = NULL;
-
-	do {
-		nread = read(pipefd, &optev, sizeof(ltimer_opt_t));
-		if (-1 == nread || 0 == nread) {
-			return;
-		}
+	int i;
+	for (i = 0; i < LTIMER_FMT_NUM; i++) {
+		p_cache->key[0][i] = -1;
+		p_cache->key[1][i] = -1;
+	}
+}
 
-		if (nread != sizeof(ltimer_opt_t)) {
-			printf("%s: read %d bytes, error info: %s!\n", __func__, nread, strerror(errno));
+//@function: render strings which differ from visible ones into back buffer, then flip buffers.
+//only called by owner of bucket clock, work thread or caller of bucket_advance.
+static void refresh_timestr(timestr_cache_t *p_cache, struct timespec ts)
+{
+	int i, changed = 0;
+	int64_t key;
+	struct tm utc;
+	unsigned seq = p_cache->seq;
+	int front = seq & 1, back = (seq + 1) & 1;
+
+	for (i = 0; i < LTIMER_FMT_NUM; i++) {
+		if (timestr_key(i, ts) != p_cache->key[front][i]) {
+			changed = 1;
 			break;
 		}
+	}
+	if (!changed) {
+		return;
+	}
 
-		p_timer = (ltimer_t *)optev.id;
-		switch (optev.opt) {
-		case EN_TIMER_OPT_ADD: {
-			p_timer->expire.tv_sec = p_bkt->curtime.tv_sec + p_timer->period.tv_sec;
-			p_timer->expire.tv_nsec = p_bkt->curtime.tv_nsec + p_timer->period.tv_nsec;
-			list_insert_reverse(&p_timer->entry, &p_bkt->active_list, compare_timer_by_entry, 1);
-			__sync_add_and_fetch(&p_bkt->count, 1);
-			break;
-		};
-		case EN_TIMER_OPT_DEL: {
-			list_del(&p_timer->entry);
-			list_add_tail(&p_timer->entry, &p_bkt->recycle_list);
-			__sync_sub_and_fetch(&p_bkt->count, 1);
-			break;
-		};
-		case EN_TIMER_OPT_MOD: {
-			if (NULL != optev.func) {
-				p_timer->func = optev.func;
-			}
-			if (NULL != optev.data) {
-				p_timer->data = optev.data;
-			}
-			if (optev.period.tv_sec != 0 || optev.period.tv_nsec != 0) {
-				list_del(&p_timer->entry);
-				p_timer->expire.tv_sec = p_bkt->curtime.tv_sec + optev.period.tv_sec;
-				p_timer->expire.tv_nsec = p_bkt->curtime.tv_nsec + optev.period.tv_nsec;
-				list_insert_reverse(&p_timer->entry, &p_bkt->active_list, compare_timer_by_entry, 1);
-			}
-			break;
-		};
-		default: {
-			break;
-		}
+	//back buffer may still be copied by readers of the previous seq, they retry once seq moves.
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	gmtime_r(&ts.tv_sec, &utc);
+	for (i = 0; i < LTIMER_FMT_NUM; i++) {
+		key = timestr_key(i, ts);
+		if (key != p_cache->key[back][i]) {
+			p_cache->len[back][i] = render_timestr(p_cache->str[back][i], i, ts, &utc);
+			p_cache->key[back][i] = key;
 		}
-	} while (1);
+	}
+	__atomic_store_n(&p_cache->seq, seq + 1, __ATOMIC_RELEASE);
 }
 
-static void* work_routine(void *arg)
+//@return: uniform random number in [0, bound).
+static inline int64_t spread_random(timer_bucket_t *p_bkt, int64_t bound)
 {
-	int retval;
-	timer_bucket_t* p_info = (timer_bucket_t*)arg;
+	uint64_t x = p_bkt->prng;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	p_bkt->prng = x;
+	return (bound > 0) ? (int64_t)(((unsigned __int128)x * (uint64_t)bound) >> 64) : 0;
+}
 
-	//set core affinity.
-	retval = set_thread_core_affinity(p_info->cpuid, p_info->thread_id);
-	if (0 != retval) {
-		printf("set_thread_core_affinity failed with error info: %s\n", strerror(errno));
-		return NULL;
-	}
+//@return: delay of first timeout, spread over phase bound for spread timers.
+static inline int64_t spread_first(timer_bucket_t *p_bkt, ltimer_t *p_timer, int64_t first)
+{
+	int64_t period = timespec_to_ns(p_timer->period);
+	int64_t bound = __atomic_load_n(&p_bkt->spread_phase, __ATOMIC_RELAXED);
 
-	//set work thread name.
-	retval = set_thread_name(p_info->name, p_info->thread_id);
-	if (0 != retval) {
-		printf("set_thread_name failed with error info: %s\n", strerror(errno));
-		return NULL;
+	if (!(p_timer->flags & TIMER_F_SPREAD)) {
+		return first;
 	}
-
-	//add pipefd[0] into epoll event.
-	retval = add_epoll_event(p_info->pipefd[0], (EPOLLIN | EPOLLET), p_info->epoll_fd);
-	if (0 != retval) {
-		printf("add_epoll_event failed with error info: %s\n", strerror(errno));
-		return NULL;
+	if (0 == bound || bound > period) {
+		bound = period;
 	}
+	return first + spread_random(p_bkt, bound);
+}
 
-	//get realtime from system.
-	retval = clock_gettime(CLOCK_REALTIME, &p_info->curtime);
-	if (0 != retval) {
-		printf("clock_gettime failed with error info: %s!\n", strerror(errno));
-		return NULL;
-	}
-	printf("%s: p_info->curtime.tv_sec = %ld\n", __func__, p_info->curtime.tv_sec);
-	printf("%s: p_info->curtime.tv_nsec = %ld\n", __func__, p_info->curtime.tv_nsec);
+//@return: period of next timeout, with jitter in [-bound / 2, bound / 2) for spread timers.
+static inline int64_t spread_period(timer_bucket_t *p_bkt, ltimer_t *p_timer)
+{
+	int64_t period = timespec_to_ns(p_timer->period);
+	int64_t bound = __atomic_load_n(&p_bkt->spread_jitter, __ATOMIC_RELAXED);
 
-	//add update system time event into epollfd.
-	struct itimerspec itmspec;
-	itmspec.it_value = p_info->resolution;
-	itmspec.it_interval = p_info->resolution;
-	retval = timerfd_settime(p_info->timerfd, 0, &itmspec, NULL);
-	if (0 != retval) {
-		printf("timerfd_settime failed with error info: %s!\n", strerror(errno));
-		return NULL;
+	if (!(p_timer->flags & TIMER_F_SPREAD) || 0 == bound) {
+		return period;
 	}
-	retval = add_epoll_event(p_info->timerfd, (EPOLLIN | EPOLLET), p_info->epoll_fd);
-	if (0 != retval) {
-		printf("add_epoll_event failed with error info: %s\n", strerror(errno));
-		return NULL;
+	if (bound > period) {
+		bound = period;
 	}
+	return period + spread_random(p_bkt, bound) - bound / 2;
+}
 
-	//epoll event loop.
-	int i, nread, nfds;
-	uint64_t nexpired = 0;
-	struct epoll_event events[MAX_EVENT_NUMBER];
+static inline timer_queue_t* timer_lane(timer_bucket_t *p_bkt, ltimer_t *p_timer)
+{
+	return (p_timer->flags & TIMER_F_HIGHPRIO) ? &p_bkt->tq_hi : &p_bkt->tq;
+}
 
-	while (1 == p_info->trigger) {
-		nfds = epoll_wait(p_info->epoll_fd, events, MAX_EVENT_NUMBER, -1);
-		if (nfds <= 0) {
-			continue;
-		}
+static inline int queue_timer(timer_bucket_t *p_bkt, ltimer_t *p_timer, int64_t expire)
+{
+	timer_queue_t *p_tq = timer_lane(p_bkt, p_timer);
+	p_timer->node.key = expire;
+	return p_tq->ops->insert(p_tq, &p_timer->node);
+}
 
-		for (i = 0; i < nfds; i++) {
-			//tick event coming, update system time, check timers in bucket.
-			if (events[i].data.fd == p_info->timerfd && (events[i].events & EPOLLIN)) {
-				nread = read(p_info->timerfd, &nexpired, sizeof(uint64_t));
-				if (sizeof(uint64_t) != nread) {
-					continue;
-				}
-				//printf("tick event coming [%ld]!\n", nexpired);
-				update_curtime(&p_info->curtime, &p_info->resolution, nexpired);
-				check_timers_in_bucket(p_info);
-			}
-			//pipe event coming, proc add/del/mod timer event.
-			else if (events[i].data.fd == p_info->pipefd[0]  && (events[i].events & EPOLLIN)) {
-				//printf("pipe event coming!\n");
-				proc_timer_opt_event(p_info->pipefd[0], p_info);
-			}
-		}
+static inline void dequeue_timer(timer_bucket_t *p_bkt, ltimer_t *p_timer)
+{
+	timer_queue_t *p_tq = timer_lane(p_bkt, p_timer);
+	if (tq_node_queued(&p_timer->node)) {
+		p_tq->ops->remove(p_tq, &p_timer->node);
 	}
-
-	return NULL;
 }
-//---------------------------------------------------------------------------------------------------------
-TimerBucketID_t create_timer_bucket(const char *name, int size, int cpuid, struct timespec resolution)
+
+//@return: next timer to expire of both lanes, NULL if none.
+static tq_node_t* peek_next_timer(timer_bucket_t *p_bkt)
 {
-	if (size < 0 || cpuid < 0
-		|| resolution.tv_sec < 0 || resolution.tv_nsec < 0
-		|| (resolution.tv_sec == 0 && resolution.tv_nsec == 0)) {
-		printf("%s: Invalid parameter!\n", __func__);
-		return -1;
+	tq_node_t *p_lo = p_bkt->tq.ops->peek_min(&p_bkt->tq);
+	tq_node_t *p_hi = p_bkt->tq_hi.ops->peek_min(&p_bkt->tq_hi);
+	if (NULL == p_lo || (NULL != p_hi && p_hi->key < p_lo->key)) {
+		return p_hi;
 	}
+	return p_lo;
+}
 
-	int retval = 0;
-	timer_bucket_t *p_bkt = (timer_bucket_t *)calloc(sizeof(timer_bucket_t), 1);
-	if (NULL == p_bkt) {
-		printf("%s: calloc failed!\n", __func__);
-		return -1;
-	}
-	p_bkt->mem_alloc_ptr = (char *)calloc(sizeof(ltimer_t), size);
-	if (NULL == p_bkt->mem_alloc_ptr) {
-		printf("%s: calloc failed!\n", __func__);
-		retval = -1;
-		goto cleanup;
+static inline void record_timer_opt(timer_bucket_t *p_bkt, int op, ltimer_t *p_timer, struct timespec period, int type)
+{
+	recorder_t *p_rec = __atomic_load_n(&p_bkt->recorder, __ATOMIC_ACQUIRE);
+	//ops are recorded on producer threads, they can't read curtime while work thread moves it.
+	if (NULL != p_rec && __atomic_load_n(&p_rec->enabled, __ATOMIC_RELAXED)) {
+		recorder_put(p_rec, op, (uint64_t)p_timer, __atomic_load_n(&p_bkt->curtime_ns, __ATOMIC_RELAXED),
+					 timespec_to_ns(period), type);
 	}
+}
 
-	if (NULL != name) {
-		snprintf(p_bkt->name, sizeof(p_bkt->name), "%s", name);
+static void recycle_timer(timer_bucket_t *p_bkt, ltimer_t *p_timer)
+{
+	__sync_sub_and_fetch(&p_bkt->count, 1);
+	if (p_timer->flags & TIMER_F_EXTERN) {
+		return;
 	}
+	pthread_spin_lock(&p_bkt->splock);
+	list_add_tail(&p_timer->node.entry, &p_bkt->recycle_list);
+	pthread_spin_unlock(&p_bkt->splock);
+}
 
-	p_bkt->timerfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK);
-	if (p_bkt->timerfd < 0) {
-		printf("%s: timerfd_create failed with error info: %s!\n", __func__, strerror(errno));
-		retval = -1;
-		goto cleanup;
-	}
+//@function: mark timer cancelled, func won't be called once this returns, except the run in progress.
+//@return: state before cancel, -1 if timer fired or cancelled already.
+static int cancel_timer(ltimer_t *p_timer)
+{
+	int state;
+	do {
+		state = __atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE);
+		if (state & (TIMER_ST_CANCELLED | TIMER_ST_DONE)) {
+			return -1;
+		}
+	} while (!__sync_bool_compare_and_swap(&p_timer->state, state, state | TIMER_ST_CANCELLED));
+	return state;
+}
 
-	retval = pipe2(p_bkt->pipefd, O_NONBLOCK);
-	if (0 != retval) {
-		printf("%s: pipe2 failed with error info: %s!\n", __func__, strerror(errno));
-		goto cleanup;
-	}
+typedef struct st_summary_walk {
+	int64_t				base;
+	int64_t				width;
+	int*				count;
+} summary_walk_t;
 
-	p_bkt->epoll_fd = epoll_create(MAX_EVENT_NUMBER);
-	if (p_bkt->epoll_fd < 0) {
-		printf("%s: epoll_create failed with error info: %s\n", __func__, strerror(errno));
-		retval = -1;
-		goto cleanup;
+static void count_expiring_timer(tq_node_t *p_node, void *arg)
+{
+	summary_walk_t *p_walk = (summary_walk_t *)arg;
+	ltimer_t *p_timer = container_of(p_node, ltimer_t, node);
+	int64_t i = (p_node->key - p_walk->base) / p_walk->width;
+
+	//cancelled timers wait to be unlinked, they will never expire.
+	if (__atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE) & TIMER_ST_CANCELLED) {
+		return;
 	}
+	p_walk->count[(i > 0) ? i : 0]++;
+}
 
-	list_init(&p_bkt->active_list);
-	list_init(&p_bkt->recycle_list);
-	pthread_spin_init(&p_bkt->splock, 0);
-	p_bkt->cur_alloc_ptr = p_bkt->mem_alloc_ptr;
-	p_bkt->resolution = resolution;
-	p_bkt->size = size;
-	p_bkt->cpuid = cpuid;
-	p_bkt->trigger = 1;
-	p_bkt->count = 0;
+//@return: slot width of expiry summary at resolution.
+static inline int64_t summary_width(struct timespec resolution)
+{
+	int64_t width = timespec_to_ns(resolution);
+	return (width < SUMMARY_MIN_WIDTH) ? SUMMARY_MIN_WIDTH : width;
+}
 
-	retval = pthread_create(&p_bkt->thread_id, NULL, work_routine, (void*)p_bkt);
-	if (retval != 0) {
-		printf("%s: pthread_create failed with error info: %s!\n", __func__, strerror(errno));
-		retval = -1;
-		goto cleanup;
+//@function: publish expiry summary once somebody has queried it, called by owner of bucket clock.
+static void publish_summary(timer_bucket_t *p_bkt)
+{
+	int i;
+	int count[SUMMARY_SLOTS];
+	expiry_summary_t *p_sum = &p_bkt->summary;
+	int64_t now = timespec_to_ns(p_bkt->curtime);
+	int64_t width = summary_width(p_bkt->resolution);
+	tq_node_t *p_head;
+	ltimer_t *p_timer;
+	int recount;
+
+	if (!__atomic_load_n(&p_sum->wanted, __ATOMIC_RELAXED)) {
+		return;
 	}
 
-	//wait for working thread update curtime.
-	while (0 == p_bkt->curtime.tv_sec) {
-		usleep(10);
+	recount = (0 == p_sum->seq || now >= p_sum->next_count);
+	if (recount) {
+		summary_walk_t walk = {now, width, count};
+		memset(count, 0, sizeof(count));
+		p_bkt->tq.ops->walk_before(&p_bkt->tq, now + SUMMARY_SLOTS * width, count_expiring_timer, &walk);
+		p_bkt->tq_hi.ops->walk_before(&p_bkt->tq_hi, now + SUMMARY_SLOTS * width, count_expiring_timer, &walk);
+		for (i = 1; i < SUMMARY_SLOTS; i++) {
+			count[i] += count[i - 1];
+		}
+	}
+	//cancelled head waits to be unlinked, it will never expire, unlink it now like expiry does.
+	while (NULL != (p_head = peek_next_timer(p_bkt))) {
+		p_timer = container_of(p_head, ltimer_t, node);
+		if (!(__atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE) & TIMER_ST_CANCELLED)) {
+			break;
+		}
+		dequeue_timer(p_bkt, p_timer);
+		recycle_timer(p_bkt, p_timer);
 	}
 
-	return (TimerBucketID_t)p_bkt;
-
-cleanup:
-	if (NULL != p_bkt->mem_alloc_ptr) {
-		free(p_bkt->mem_alloc_ptr);
-		p_bkt->mem_alloc_ptr = NULL;
+	__atomic_store_n(&p_sum->seq, p_sum->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	p_sum->now = now;
+	p_sum->head = (NULL != p_head) ? p_head->key : INT64_MAX;
+	if (recount) {
+		p_sum->base = now;
+		p_sum->width = width;
+		p_sum->next_count = now + width;
+		memcpy(p_sum->count, count, sizeof(count));
 	}
-	if (0 != p_bkt->timerfd) {
-		close(p_bkt->timerfd);
-		p_bkt->timerfd = 0;
+	__atomic_store_n(&p_sum->seq, p_sum->seq + 1, __ATOMIC_RELEASE);
+}
+
+//@function: mark summary wanted and begin a read of it.
+//@return: seq of a stable summary, 0 if nothing is published yet.
+static unsigned begin_summary_read(timer_bucket_t *p_bkt)
+{
+	unsigned seq;
+	expiry_summary_t *p_sum = &p_bkt->summary;
+
+	if (!__atomic_load_n(&p_sum->wanted, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&p_sum->wanted, 1, __ATOMIC_RELAXED);
 	}
-	if (0 != p_bkt->pipefd[0]) {
-		close(p_bkt->pipefd[0]);
-		p_bkt->pipefd[0] = 0;
-		close(p_bkt->pipefd[1]);
-		p_bkt->pipefd[1] = 0;
+	//virtual bucket or callback on work thread is queried by owner of bucket clock, publish right away.
+	if ((p_bkt->flags & LTIMER_BKT_F_VIRTUAL) || pthread_equal(pthread_self(), p_bkt->thread_id)) {
+		publish_summary(p_bkt);
 	}
-	if (0 != p_bkt->epoll_fd) {
-		close(p_bkt->epoll_fd);
-		p_bkt->epoll_fd = 0;
+	//work thread publishes from next tick on, don't wait for it.
+	if (0 == (seq = __atomic_load_n(&p_sum->seq, __ATOMIC_ACQUIRE))) {
+		return 0;
 	}
-	if (NULL != p_bkt) {
-		free(p_bkt);
-		p_bkt = NULL;
+	while (seq & 1) {
+		sched_yield();
+		seq = __atomic_load_n(&p_sum->seq, __ATOMIC_ACQUIRE);
 	}
-	return -1;
+	return seq;
 }
 
-void destroy_timer_bucket(TimerBucketID_t bktid)
+static inline int end_summary_read(timer_bucket_t *p_bkt, unsigned seq)
 {
-	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (seq == __atomic_load_n(&p_bkt->summary.seq, __ATOMIC_RELAXED));
+}
 
-	p_bkt->trigger = 0;
-	pthread_join(p_bkt->thread_id, NULL);
-	pthread_spin_destroy(&p_bkt->splock);
-	if (0 != p_bkt->timerfd) {
-		close(p_bkt->timerfd);
-		p_bkt->timerfd = 0;
+//@function: fire a timer popped from a lane.
+static void fire_timer(timer_bucket_t *p_bkt, ltimer_t *pos, int64_t now, int *p_nfired)
+{
+	//call proc func unless cancelled.
+	if (!__sync_bool_compare_and_swap(&pos->state, 0, TIMER_ST_RUNNING)) {
+		recycle_timer(p_bkt, pos);
+		return;
 	}
-	if (0 != p_bkt->pipefd[0]) {
-		close(p_bkt->pipefd[0]);
-		p_bkt->pipefd[0] = 0;
-		close(p_bkt->pipefd[1]);
-		p_bkt->pipefd[1] = 0;
+	if ((pos->flags & TIMER_F_CQ) && 0 != timer_cq_push(pos->cq, (TimerID_t)pos, pos->data)) {
+		//consumer is behind and its ring is full, deliver on next tick.
+		if (__sync_bool_compare_and_swap(&pos->state, TIMER_ST_RUNNING, 0)) {
+			queue_timer(p_bkt, pos, now + timespec_to_ns(p_bkt->resolution));
+		} else {
+			__sync_lock_test_and_set(&pos->state, TIMER_ST_CANCELLED);
+			recycle_timer(p_bkt, pos);
+		}
+		return;
 	}
-	if (0 != p_bkt->epoll_fd) {
-		close(p_bkt->epoll_fd);
-		p_bkt->epoll_fd = 0;
+	(*p_nfired)++;
+	record_timer_opt(p_bkt, EN_LTIMER_REC_EXPIRE, pos, pos->period, pos->type);
+	LTIMER_PROBE3(fire, pos, pos->node.key, now - pos->node.key);
+
+	//extern node may be released by its owner inside callback, don't touch it afterwards.
+	if (pos->flags & TIMER_F_EXTERN) {
+		__sync_sub_and_fetch(&p_bkt->count, 1);
+		pos->func(pos->data);
+		return;
+	}
+
+	if (!(pos->flags & TIMER_F_CQ)) {
+		pos->func(pos->data);
 	}
-	if (NULL != p_bkt->mem_alloc_ptr) {
-		free(p_bkt->mem_alloc_ptr);
-		p_bkt->mem_alloc_ptr = NULL;
+
+	//once timer, recycle.
+	//cycle timer, setup time, insert into timer queue again unless cancelled inside callback or meanwhile.
+	if (0 == pos->type) {
+		__sync_lock_test_and_set(&pos->state, TIMER_ST_DONE);
+		recycle_timer(p_bkt, pos);
+	} else if (__sync_bool_compare_and_swap(&pos->state, TIMER_ST_RUNNING, 0)) {
+		queue_timer(p_bkt, pos, now + spread_period(p_bkt, pos));
+	} else {
+		__sync_lock_test_and_set(&pos->state, TIMER_ST_CANCELLED);
+		recycle_timer(p_bkt, pos);
 	}
-	free(p_bkt);
 }
 
-TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc func, void *data, int type)
+//@function: take a popped timer not fired yet out of batch and recycle it, its node memory is going back to owner.
+static void unbatch_timer(timer_bucket_t *p_bkt, ltimer_t *p_timer)
 {
-	if (bktid == 0
-		|| tm.tv_sec < 0 || tm.tv_nsec < 0 || (tm.tv_sec == 0 && tm.tv_nsec == 0)
-		|| NULL == func || NULL == data || (type != 0 && type != 1)) {
-		printf("%s: Invalid parameter!\n", __func__);
-		return -1;
+	int i;
+	for (i = 0; i < p_bkt->nexpiring; i++) {
+		if (p_bkt->expiring[i] == p_timer) {
+			p_bkt->expiring[i] = NULL;
+			recycle_timer(p_bkt, p_timer);
+			return;
+		}
 	}
+}
 
-	int nret = 0;
-	ltimer_opt_t optev;
-	ltimer_t *p_timer = NULL;
-	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+//@function: fire expired timers of a lane, at most max of them.
+//expired timers are popped a batch at a time, then fired with nodes and data prefetched a few timers ahead.
+//callbacks may add or delete timers meanwhile, popped ones are covered by their state word,
+//released extern nodes are taken out of batch by unbatch_timer.
+//@return: number of timers popped, fired or cancelled ones.
+static int expire_timers(timer_bucket_t *p_bkt, timer_queue_t *p_tq, int64_t now, int max, int *p_nfired)
+{
+	int i, n, npopped = 0;
+	tq_node_t *p_node;
+	ltimer_t *p_timer, *p_ahead;
+
+	while (npopped < max) {
+		for (n = 0; n < EXPIRE_BATCH && npopped + n < max && NULL != (p_node = p_tq->ops->pop_expired(p_tq, now)); n++) {
+			p_bkt->expiring[n] = container_of(p_node, ltimer_t, node);
+		}
+		p_bkt->nexpiring = n;
+		npopped += n;
+
+		//prefetch node of 2 * EXPIRE_PREFETCH ahead, then data of EXPIRE_PREFETCH ahead from its fetched node.
+		//kept inline, gcc takes a function doing nothing but prefetch as pure and drops calls to it.
+		for (i = 0; i < n; i++) {
+			if (i + 2 * EXPIRE_PREFETCH < n && NULL != (p_ahead = p_bkt->expiring[i + 2 * EXPIRE_PREFETCH])) {
+				//node spans up to three cache lines.
+				list_prefetch(p_ahead);
+				list_prefetch((char *)p_ahead + 64);
+				list_prefetch((char *)(p_ahead + 1) - 1);
+			}
+			if (i + EXPIRE_PREFETCH < n && NULL != (p_ahead = p_bkt->expiring[i + EXPIRE_PREFETCH])
+				&& (p_ahead->flags & TIMER_F_PREFETCH)) {
+				//callbacks tend to update what data points to.
+				__builtin_prefetch(p_ahead->data, 1, 3);
+			}
+			//out of batch before its callback, a node released inside it must not be unbatched again.
+			if (NULL != (p_timer = p_bkt->expiring[i])) {
+				p_bkt->expiring[i] = NULL;
+				fire_timer(p_bkt, p_timer, now, p_nfired);
+			}
+		}
+		p_bkt->nexpiring = 0;
+		if (n < EXPIRE_BATCH) {
+			break;
+		}
+	}
+	return npopped;
+}
+
+//@function: catch up with ticks passed while firing timers, so high priority timers due meanwhile are seen.
+static void refresh_curtime(timer_bucket_t *p_bkt)
+{
+	int64_t nexpired = 0;
+	uint64_t nticks = 0;
+	struct timespec now;
+
+	if (p_bkt->flags & LTIMER_BKT_F_VIRTUAL) {
+		return;
+	}
+	if (NULL != p_bkt->uring) {
+		//io_uring worker counts ticks from wall clock.
+		clock_gettime(CLOCK_REALTIME, &now);
+		nexpired = (timespec_to_ns(now) - timespec_to_ns(p_bkt->curtime)) / timespec_to_ns(p_bkt->resolution);
+	} else if (sizeof(uint64_t) == read(p_bkt->timerfd, &nticks, sizeof(uint64_t))) {
+		//ticks consumed here are not seen by epoll loop again.
+		nexpired = (int64_t)nticks;
+	}
+	if (nexpired > 0) {
+		advance_curtime(p_bkt, nexpired);
+		publish_curtime(&p_bkt->curtime);
+		refresh_timestr(&p_bkt->timestr, p_bkt->curtime);
+	}
+}
+
+//@return: number of timers fired.
+static int check_timers_in_bucket(timer_bucket_t *p_bkt)
+{
+	int nfired = 0, nbatch, nleft = INT_MAX;
+	int64_t deadline = INT64_MAX;
+	int64_t now = timespec_to_ns(p_bkt->curtime);
+	struct timespec ts;
+
+	//budget bounds a wakeup of work thread, or a tick of bucket_advance.
+	if (__atomic_load_n(&p_bkt->budget_count, __ATOMIC_RELAXED) > 0) {
+		nleft = __atomic_load_n(&p_bkt->budget_count, __ATOMIC_RELAXED);
+	}
+	if (__atomic_load_n(&p_bkt->budget_ns, __ATOMIC_RELAXED) > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		deadline = timespec_to_ns(ts) + __atomic_load_n(&p_bkt->budget_ns, __ATOMIC_RELAXED);
+	}
+	p_bkt->carry = 0;
+
+	//high priority lane first, then low priority lane in batches,
+	//between batches high priority lane is checked again against a fresh clock.
+	expire_timers(p_bkt, &p_bkt->tq_hi, now, INT_MAX, &nfired);
+	while (1) {
+		nbatch = (nleft < EXPIRE_LO_BATCH) ? nleft : EXPIRE_LO_BATCH;
+		if (expire_timers(p_bkt, &p_bkt->tq, now, nbatch, &nfired) < nbatch) {
+			break;
+		}
+		nleft -= nbatch;
+		if (0 == nleft) {
+			p_bkt->carry = 1;
+			break;
+		}
+		if (INT64_MAX != deadline) {
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			if (timespec_to_ns(ts) >= deadline) {
+				p_bkt->carry = 1;
+				break;
+			}
+		}
+		if (p_bkt->tq_hi.count > 0) {
+			refresh_curtime(p_bkt);
+			now = timespec_to_ns(p_bkt->curtime);
+			expire_timers(p_bkt, &p_bkt->tq_hi, now, INT_MAX, &nfired);
+		}
+	}
+	return nfired;
+}
+
+static int reconf_bucket(timer_bucket_t *p_bkt, bucket_reconf_t *p_rc);
+
+static void proc_timer_opt(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev)
+{
+	ltimer_t* p_timer = (ltimer_t *)p_optev->id;
+
+	switch (p_optev->opt) {
+	case EN_TIMER_OPT_ADD: {
+		//mods folded into a staged add.
+		struct timespec first = p_timer->period;
+		if (NULL != p_optev->func) {
+			p_timer->func = p_optev->func;
+		}
+		if (NULL != p_optev->data) {
+			p_timer->data = p_optev->data;
+		}
+		if (p_optev->period.tv_sec != 0 || p_optev->period.tv_nsec != 0) {
+			first = p_optev->period;
+		}
+
+		__sync_add_and_fetch(&p_bkt->count, 1);
+		//cancelled before work thread got it, no need to queue.
+		if (__atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE) & TIMER_ST_CANCELLED) {
+			recycle_timer(p_bkt, p_timer);
+		} else if (0 != queue_timer(p_bkt, p_timer,
+									timespec_to_ns(p_bkt->curtime) + spread_first(p_bkt, p_timer, timespec_to_ns(first)))) {
+			printf("%s: queue timer failed!\n", __func__);
+			recycle_timer(p_bkt, p_timer);
+		}
+		break;
+	};
+	case EN_TIMER_OPT_DEL: {
+		//unlink hint of a cancelled timer, slot may be fired and reused meanwhile, check state again.
+		if (tq_node_queued(&p_timer->node)
+			&& (__atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE) & TIMER_ST_CANCELLED)) {
+			dequeue_timer(p_bkt, p_timer);
+			recycle_timer(p_bkt, p_timer);
+		}
+		break;
+	};
+	case EN_TIMER_OPT_DEL_SYNC: {
+		//data carries the done flag of waiting thread.
+		if (tq_node_queued(&p_timer->node)) {
+			dequeue_timer(p_bkt, p_timer);
+			recycle_timer(p_bkt, p_timer);
+		} else {
+			unbatch_timer(p_bkt, p_timer);
+		}
+		__sync_lock_test_and_set((int *)p_optev->data, 1);
+		break;
+	};
+	case EN_TIMER_OPT_RECONF: {
+		bucket_reconf_t *p_rc = (bucket_reconf_t *)p_optev->data;
+		p_rc->result = reconf_bucket(p_bkt, p_rc);
+		__sync_lock_test_and_set(&p_rc->done, 1);
+		break;
+	};
+	case EN_TIMER_OPT_STOP: {
+		p_bkt->trigger = 0;
+		break;
+	};
+	case EN_TIMER_OPT_MOD: {
+		if (NULL != p_optev->func) {
+			p_timer->func = p_optev->func;
+		}
+		if (NULL != p_optev->data) {
+			p_timer->data = p_optev->data;
+		}
+		if ((p_optev->period.tv_sec != 0 || p_optev->period.tv_nsec != 0) && tq_node_queued(&p_timer->node)) {
+			dequeue_timer(p_bkt, p_timer);
+			queue_timer(p_bkt, p_timer, timespec_to_ns(p_bkt->curtime) + timespec_to_ns(p_optev->period));
+		}
+		break;
+	};
+	default: {
+		break;
+	}
+	}
+}
+
+static void proc_timer_opt_event(int pipefd, timer_bucket_t *p_bkt)
+{
+	int i, nread = 0;
+	ltimer_opt_t optev[OPT_READ_BATCH];
+
+	//writers put whole events atomically, so every read gets whole events.
+	do {
+		nread = read(pipefd, optev, sizeof(optev));
+		if (-1 == nread || 0 == nread) {
+			return;
+		}
+
+		if (nread % sizeof(ltimer_opt_t) != 0) {
+			printf("%s: read %d bytes, error info: %s!\n", __func__, nread, strerror(errno));
+			break;
+		}
+
+		LTIMER_PROBE2(opt_batch, p_bkt, nread / sizeof(ltimer_opt_t));
+		for (i = 0; i < (int)(nread / sizeof(ltimer_opt_t)); i++) {
+			proc_timer_opt(p_bkt, &optev[i]);
+		}
+	} while (nread == sizeof(optev));
+}
+
+static int uring_post_opts(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev, int n);
+
+//@function: hand n timer events to work thread, all or none.
+//@return: -1 on error, errno EAGAIN if they don't fit now, 0 on success.
+static int write_timer_opts(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev, int n)
+{
+	if (NULL != p_bkt->uring) {
+		return uring_post_opts(p_bkt, p_optev, n);
+	}
+	//writing bytes less than PIPE_BUF is atomic operation is guaranteed by system.
+	if (write(p_bkt->pipefd[1], p_optev, n * sizeof(ltimer_opt_t)) != (ssize_t)(n * sizeof(ltimer_opt_t))) {
+		return -1;
+	}
+	return 0;
+}
+
+//@function: hand a timer event to the bucket owner.
+//virtual bucket has no work thread, the caller applies the event right away.
+static int post_timer_opt(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev)
+{
+	if (p_bkt->flags & LTIMER_BKT_F_VIRTUAL) {
+		proc_timer_opt(p_bkt, p_optev);
+		return 0;
+	}
+
+	return write_timer_opts(p_bkt, p_optev, 1);
+}
+
+//@function: give a timer never seen by work thread back to pool.
+static void putback_timer(timer_bucket_t *p_bkt, ltimer_t *p_timer)
+{
+	pthread_spin_lock(&p_bkt->splock);
+	list_add_head(&p_timer->node.entry, &p_bkt->recycle_list);
+	pthread_spin_unlock(&p_bkt->splock);
+}
+
+//@function: merge fields set in a later mod into an earlier add or mod of the same timer.
+static void merge_timer_opt(ltimer_opt_t *p_dst, ltimer_opt_t *p_src)
+{
+	if (p_src->period.tv_sec != 0 || p_src->period.tv_nsec != 0) {
+		p_dst->period = p_src->period;
+	}
+	if (NULL != p_src->func) {
+		p_dst->func = p_src->func;
+	}
+	if (NULL != p_src->data) {
+		p_dst->data = p_src->data;
+	}
+}
+
+static void drain_timer_opt_event(timer_bucket_t *p_bkt);
+
+//@function: write ops of a bucket, waiting for work thread to make room while pipe is full.
+//@return: -1 if they can't be written, 0 on success.
+static int write_bucket_opts(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev, int n)
+{
+	while (0 != write_timer_opts(p_bkt, p_optev, n)) {
+		if (EAGAIN != errno || !p_bkt->trigger) {
+			return -1;
+		}
+		//a callback batching on work thread drains the pipe itself.
+		if (pthread_equal(pthread_self(), p_bkt->thread_id)) {
+			drain_timer_opt_event(p_bkt);
+		} else {
+			sched_yield();
+		}
+	}
+	return 0;
+}
+
+//@function: write staged ops, one write per bucket, each stays below PIPE_BUF so it's atomic.
+//@return: -1 if ops of some bucket are lost since last flush, 0 on success.
+static int flush_opt_batch(opt_batch_t *p_batch)
+{
+	int i, j, n, retval = p_batch->lost ? -1 : 0;
+	ltimer_opt_t optev[OPT_READ_BATCH];
+	timer_bucket_t *p_bkt;
+
+	p_batch->lost = 0;
+	while (p_batch->count > 0) {
+		p_bkt = p_batch->bkts[0];
+		for (i = 0, j = 0, n = 0; i < p_batch->count; i++) {
+			if (p_batch->bkts[i] == p_bkt) {
+				optev[n++] = p_batch->optev[i];
+			} else {
+				p_batch->bkts[j] = p_batch->bkts[i];
+				p_batch->optev[j++] = p_batch->optev[i];
+			}
+		}
+		p_batch->count = j;
+
+		if (0 != write_bucket_opts(p_bkt, optev, n)) {
+			printf("%s: write pipe error!\n", __func__);
+			//handles of added timers are out already, cancel them but never reuse their slots.
+			for (i = 0; i < n; i++) {
+				if (EN_TIMER_OPT_ADD == optev[i].opt) {
+					__sync_lock_test_and_set(&((ltimer_t *)optev[i].id)->state, TIMER_ST_CANCELLED);
+				}
+			}
+			retval = -1;
+		}
+	}
+	return retval;
+}
+
+//@function: stage an op, coalesced with the latest op staged for the same timer.
+//add then del cancel out, mods fold into the add or mod before them, del replaces a staged mod.
+//a slot deleted while staged may come back to a new add, so older ops of the id are left alone.
+//@return: 0 once staged, ops lost by a threshold flush are reported by next flush.
+static int stage_timer_opt(opt_batch_t *p_batch, timer_bucket_t *p_bkt, ltimer_opt_t *p_optev)
+{
+	int i;
+	ltimer_opt_t *p_staged = NULL;
+
+	for (i = p_batch->count - 1; i >= 0; i--) {
+		if (p_batch->optev[i].id == p_optev->id) {
+			p_staged = &p_batch->optev[i];
+			break;
+		}
+	}
+
+	if (NULL != p_staged) {
+		if (EN_TIMER_OPT_MOD == p_optev->opt) {
+			//mod after a staged del changes nothing.
+			if (EN_TIMER_OPT_DEL != p_staged->opt) {
+				merge_timer_opt(p_staged, p_optev);
+			}
+			return 0;
+		}
+		if (EN_TIMER_OPT_DEL == p_optev->opt) {
+			if (EN_TIMER_OPT_ADD == p_staged->opt) {
+				//work thread never knows this timer.
+				memmove(&p_batch->bkts[i], &p_batch->bkts[i + 1], (p_batch->count - i - 1) * sizeof(p_batch->bkts[0]));
+				memmove(p_staged, p_staged + 1, (p_batch->count - i - 1) * sizeof(ltimer_opt_t));
+				p_batch->count--;
+				putback_timer(p_bkt, (ltimer_t *)p_optev->id);
+			} else {
+				*p_staged = *p_optev;
+			}
+			return 0;
+		}
+	}
+
+	p_batch->bkts[p_batch->count] = p_bkt;
+	p_batch->optev[p_batch->count++] = *p_optev;
+	if (p_batch->count >= p_batch->threshold && 0 != flush_opt_batch(p_batch)) {
+		p_batch->lost = 1;
+	}
+	return 0;
+}
+
+//@function: stage op when calling thread is batching, post it otherwise.
+static int submit_timer_opt(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev)
+{
+	if (NULL != t_batch && !(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)) {
+		return stage_timer_opt(t_batch, p_bkt, p_optev);
+	}
+	return post_timer_opt(p_bkt, p_optev);
+}
+
+static void batch_key_destructor(void *arg)
+{
+	opt_batch_t *p_batch = (opt_batch_t *)arg;
+	flush_opt_batch(p_batch);
+	free(p_batch);
+	t_batch = NULL;
+}
+
+static void batch_key_create(void)
+{
+	pthread_key_create(&g_batch_key, batch_key_destructor);
+}
+
+static void uring_proc_opts(timer_bucket_t *p_bkt);
+
+//@function: apply every pending timer event, usable from callbacks on work thread.
+static void drain_timer_opt_event(timer_bucket_t *p_bkt)
+{
+	if (NULL != p_bkt->uring) {
+		uring_proc_opts(p_bkt);
+	} else {
+		proc_timer_opt_event(p_bkt->pipefd[0], p_bkt);
+	}
+}
+
+static void proc_tick_event(timer_bucket_t *p_info, uint64_t nexpired)
+{
+	int nfired;
+	int64_t lateness = 0;
+	struct timespec now;
+
+	advance_curtime(p_info, nexpired);
+	publish_curtime(&p_info->curtime);
+	refresh_timestr(&p_info->timestr, p_info->curtime);
+	nfired = check_timers_in_bucket(p_info);
+	publish_summary(p_info);
+	if (NULL != p_info->recorder) {
+		recorder_flush(p_info->recorder);
+	}
+
+	//wall clock is read only while tracer is attached.
+	if (LTIMER_PROBE_ENABLED(tick)) {
+		clock_gettime(CLOCK_REALTIME, &now);
+		lateness = timespec_to_ns(now) - timespec_to_ns(p_info->curtime);
+	}
+	LTIMER_PROBE4(tick, p_info, nexpired, nfired, lateness);
+}
+
+//@function: common setup of work thread, bind core, set name, get start time.
+static int prepare_work_routine(timer_bucket_t* p_info)
+{
+	int retval;
+
+	//set core affinity.
+	retval = set_thread_core_affinity(p_info->cpuid, p_info->thread_id);
+	if (0 != retval) {
+		printf("set_thread_core_affinity failed with error info: %s\n", strerror(errno));
+		return -1;
+	}
+
+	//set work thread name.
+	retval = set_thread_name(p_info->name, p_info->thread_id);
+	if (0 != retval) {
+		printf("set_thread_name failed with error info: %s\n", strerror(errno));
+		return -1;
+	}
+
+	//get realtime from system.
+	retval = clock_gettime(CLOCK_REALTIME, &p_info->curtime);
+	if (0 != retval) {
+		printf("clock_gettime failed with error info: %s!\n", strerror(errno));
+		return -1;
+	}
+	printf("%s: p_info->curtime.tv_sec = %ld\n", __func__, p_info->curtime.tv_sec);
+	printf("%s: p_info->curtime.tv_nsec = %ld\n", __func__, p_info->curtime.tv_nsec);
+	__atomic_store_n(&p_info->curtime_ns, timespec_to_ns(p_info->curtime), __ATOMIC_RELAXED);
+	refresh_timestr(&p_info->timestr, p_info->curtime);
+	return 0;
+}
+
+static void* work_routine(void *arg)
+{
+	int retval;
+	timer_bucket_t* p_info = (timer_bucket_t*)arg;
+
+	//add pipefd[0] into epoll event.
+	retval = add_epoll_event(p_info->pipefd[0], (EPOLLIN | EPOLLET), p_info->epoll_fd);
+	if (0 != retval) {
+		printf("add_epoll_event failed with error info: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	if (0 != prepare_work_routine(p_info)) {
+		return NULL;
+	}
+
+	//add update system time event into epollfd.
+	struct itimerspec itmspec;
+	itmspec.it_value = p_info->resolution;
+	itmspec.it_interval = p_info->resolution;
+	retval = timerfd_settime(p_info->timerfd, 0, &itmspec, NULL);
+	if (0 != retval) {
+		printf("timerfd_settime failed with error info: %s!\n", strerror(errno));
+		return NULL;
+	}
+	retval = add_epoll_event(p_info->timerfd, (EPOLLIN | EPOLLET), p_info->epoll_fd);
+	if (0 != retval) {
+		printf("add_epoll_event failed with error info: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	//epoll event loop.
+	int i, nread, nfds, ticked;
+	uint64_t nexpired = 0;
+	struct epoll_event events[MAX_EVENT_NUMBER];
+
+	while (1 == p_info->trigger) {
+		//expired timers left over by budget, just poll pending events before firing them.
+		nfds = epoll_wait(p_info->epoll_fd, events, MAX_EVENT_NUMBER, p_info->carry ? 0 : -1);
+		if (nfds < 0 || (0 == nfds && !p_info->carry)) {
+			continue;
+		}
+
+		ticked = 0;
+		for (i = 0; i < nfds; i++) {
+			//tick event coming, update system time, check timers in bucket.
+			if (events[i].data.fd == p_info->timerfd && (events[i].events & EPOLLIN)) {
+				nread = read(p_info->timerfd, &nexpired, sizeof(uint64_t));
+				if (sizeof(uint64_t) != nread) {
+					continue;
+				}
+				//printf("tick event coming [%ld]!\n", nexpired);
+				proc_tick_event(p_info, nexpired);
+				ticked = 1;
+			}
+			//pipe event coming, proc add/del/mod timer event.
+			else if (events[i].data.fd == p_info->pipefd[0]  && (events[i].events & EPOLLIN)) {
+				//printf("pipe event coming!\n");
+				proc_timer_opt_event(p_info->pipefd[0], p_info);
+			}
+		}
+		if (p_info->carry && !ticked) {
+			proc_tick_event(p_info, 0);
+		}
+	}
+
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------------------------
+//io_uring worker: producers queue timer events in a shared ring without any syscall, a producer
+//writes a doorbell byte to the pipe only when worker is going to sleep. worker sleeps on one
+//io_uring_enter, a doorbell read linked with a timeout at next tick, whichever completes first
+//cancels the other. no multishot read or IORING_OP_MSG_RING: events never pass through the kernel,
+//and MSG_RING would still cost a producer an io_uring_enter per event.
+//sqes are filled by worker only and published on submit, ring runs without SQPOLL.
+
+//@function: queue n events for io_uring worker, all or none, wake worker if it's going to sleep.
+//@return: -1 with errno EAGAIN if ring is full, 0 on success.
+static int uring_post_opts(timer_bucket_t *p_bkt, ltimer_opt_t *p_optev, int n)
+{
+	int i;
+	char bell = 0;
+	uring_worker_t *p_uw = p_bkt->uring;
+
+	pthread_spin_lock(&p_uw->olock);
+	if (URING_OPT_RING - (p_uw->otail - __atomic_load_n(&p_uw->ohead, __ATOMIC_ACQUIRE)) < (unsigned)n) {
+		pthread_spin_unlock(&p_uw->olock);
+		errno = EAGAIN;
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		p_uw->opts[(p_uw->otail + i) & (URING_OPT_RING - 1)] = p_optev[i];
+	}
+	__atomic_store_n(&p_uw->otail, p_uw->otail + n, __ATOMIC_RELEASE);
+	pthread_spin_unlock(&p_uw->olock);
+
+	//pairs with fence of worker between setting idle and checking ring.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&p_uw->idle, __ATOMIC_RELAXED) && __sync_lock_test_and_set(&p_uw->idle, 0)) {
+		//a full pipe holds doorbells already.
+		if (write(p_bkt->pipefd[1], &bell, 1) < 0 && EAGAIN != errno) {
+			printf("%s: write pipe error!\n", __func__);
+		}
+	}
+	return 0;
+}
+
+//@function: apply queued events, called by work thread.
+static void uring_proc_opts(timer_bucket_t *p_bkt)
+{
+	int n = 0;
+	ltimer_opt_t optev;
+	uring_worker_t *p_uw = p_bkt->uring;
+	unsigned tail = __atomic_load_n(&p_uw->otail, __ATOMIC_ACQUIRE);
+
+	//event is copied out before its slot goes back to producers, applying it may drain ring again.
+	while (p_uw->ohead != tail) {
+		optev = p_uw->opts[p_uw->ohead & (URING_OPT_RING - 1)];
+		__atomic_store_n(&p_uw->ohead, p_uw->ohead + 1, __ATOMIC_RELEASE);
+		proc_timer_opt(p_bkt, &optev);
+		n++;
+		tail = __atomic_load_n(&p_uw->otail, __ATOMIC_ACQUIRE);
+	}
+	if (n > 0) {
+		LTIMER_PROBE2(opt_batch, p_bkt, n);
+	}
+}
+
+//@function: queue doorbell read linked with timeout of next tick.
+static int uring_arm_wait(timer_bucket_t *p_bkt)
+{
+	uring_worker_t *p_uw = p_bkt->uring;
+	struct io_uring_sqe *p_read = uring_get_sqe(&p_uw->ring);
+	struct io_uring_sqe *p_sqe = uring_get_sqe(&p_uw->ring);
+	if (NULL == p_read || NULL == p_sqe) {
+		return -1;
+	}
+
+	p_read->opcode = IORING_OP_READ;
+	p_read->fd = p_bkt->pipefd[0];
+	p_read->addr = (uint64_t)(uintptr_t)p_uw->dbuf;
+	p_read->len = sizeof(p_uw->dbuf);
+	p_read->off = (uint64_t)-1;
+	p_read->flags = IOSQE_IO_LINK;
+	p_read->user_data = EN_URING_UD_PIPE;
+	p_uw->read_armed = 1;
+
+	if (p_uw->tick_flags & IORING_TIMEOUT_ABS) {
+		struct timespec next = timespec_add(p_bkt->curtime, p_bkt->resolution);
+		p_uw->next_tick.tv_sec = next.tv_sec;
+		p_uw->next_tick.tv_nsec = next.tv_nsec;
+	} else {
+		p_uw->next_tick.tv_sec = p_bkt->resolution.tv_sec;
+		p_uw->next_tick.tv_nsec = p_bkt->resolution.tv_nsec;
+	}
+	p_sqe->opcode = IORING_OP_LINK_TIMEOUT;
+	p_sqe->fd = -1;
+	p_sqe->addr = (uint64_t)(uintptr_t)&p_uw->next_tick;
+	p_sqe->len = 1;
+	p_sqe->timeout_flags = p_uw->tick_flags;
+	p_sqe->user_data = EN_URING_UD_TICK;
+	p_uw->tick_armed = 1;
+	return 0;
+}
+
+//@function: consume completions of doorbell read and its timeout.
+static void uring_reap_events(timer_bucket_t *p_bkt)
+{
+	struct io_uring_cqe *p_cqe;
+	uring_worker_t *p_uw = p_bkt->uring;
+
+	while (NULL != (p_cqe = uring_peek_cqe(&p_uw->ring))) {
+		uint64_t tag = p_cqe->user_data;
+		int res = p_cqe->res;
+		uring_cqe_seen(&p_uw->ring);
+
+		if (EN_URING_UD_PIPE == tag) {
+			p_uw->read_armed = 0;
+		} else if (EN_URING_UD_TICK == tag) {
+			p_uw->tick_armed = 0;
+			if (-EINVAL == res && (p_uw->tick_flags & IORING_TIMEOUT_ABS)) {
+				//abs realtime timeout unsupported by kernel, go on with relative timeout.
+				p_uw->tick_flags = 0;
+			}
+		}
+	}
+}
+
+static void* uring_work_routine(void *arg)
+{
+	timer_bucket_t* p_info = (timer_bucket_t*)arg;
+	uring_worker_t *p_uw = p_info->uring;
+	struct timespec now;
+	int64_t nexpired;
+
+	if (0 != prepare_work_routine(p_info)) {
+		return NULL;
+	}
+
+	p_uw->tick_flags = IORING_TIMEOUT_ABS | IORING_TIMEOUT_REALTIME;
+	while (1 == p_info->trigger) {
+		uring_proc_opts(p_info);
+
+		//expired timers left over by budget, no sleep before firing them.
+		if (!p_info->carry) {
+			__atomic_store_n(&p_uw->idle, 1, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (p_uw->ohead != __atomic_load_n(&p_uw->otail, __ATOMIC_ACQUIRE)) {
+				__sync_lock_test_and_set(&p_uw->idle, 0);
+				continue;
+			}
+			//a doorbell read or its timeout may still be on the way back from last wait.
+			if (!p_uw->read_armed && !p_uw->tick_armed) {
+				uring_arm_wait(p_info);
+			}
+			if (uring_submit_and_wait(&p_uw->ring, 1) < 0 && EINTR != errno) {
+				printf("%s: io_uring_enter failed with error info: %s!\n", __func__, strerror(errno));
+				break;
+			}
+			__sync_lock_test_and_set(&p_uw->idle, 0);
+			uring_reap_events(p_info);
+			uring_proc_opts(p_info);
+		}
+
+		//ticks are counted from wall clock, wakeup by doorbell may come with some due too.
+		clock_gettime(CLOCK_REALTIME, &now);
+		nexpired = (timespec_to_ns(now) - timespec_to_ns(p_info->curtime)) / timespec_to_ns(p_info->resolution);
+		if (nexpired > 0 || p_info->carry) {
+			proc_tick_event(p_info, (nexpired > 0) ? nexpired : 0);
+		}
+	}
+
+	return NULL;
+}
+
+//@function: apply reconfiguration, called by owner of bucket clock.
+static int reconf_bucket(timer_bucket_t *p_bkt, bucket_reconf_t *p_rc)
+{
+	int retval = 0;
+	uint64_t nexpired = 0;
+	struct itimerspec itmspec;
+
+	if (p_rc->cpuid >= 0 && !(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)) {
+		if (0 != set_thread_core_affinity(p_rc->cpuid, p_bkt->thread_id)) {
+			printf("%s: set_thread_core_affinity failed!\n", __func__);
+			retval = -1;
+		} else {
+			p_bkt->cpuid = p_rc->cpuid;
+		}
+	}
+	if (0 == p_rc->resolution.tv_sec && 0 == p_rc->resolution.tv_nsec) {
+		return retval;
+	}
+
+	//wheel keeps slot width of creation, queued timers stay in their slots.
+	//io_uring worker is awake while applying events, its next wait is armed with new resolution.
+	if (NULL != p_bkt->uring) {
+		p_bkt->resolution = p_rc->resolution;
+	} else if (!(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)) {
+		//ticks due at old resolution are counted before timerfd is re-armed.
+		if (sizeof(uint64_t) == read(p_bkt->timerfd, &nexpired, sizeof(uint64_t))) {
+			advance_curtime(p_bkt, nexpired);
+			publish_curtime(&p_bkt->curtime);
+		}
+		p_bkt->resolution = p_rc->resolution;
+		itmspec.it_value = p_rc->resolution;
+		itmspec.it_interval = p_rc->resolution;
+		if (0 != timerfd_settime(p_bkt->timerfd, 0, &itmspec, NULL)) {
+			printf("%s: timerfd_settime failed with error info: %s!\n", __func__, strerror(errno));
+			retval = -1;
+		}
+	} else {
+		p_bkt->resolution = p_rc->resolution;
+	}
+
+	//slot counts were made at old width, recount at new one right away.
+	p_bkt->summary.next_count = INT64_MIN;
+	publish_summary(p_bkt);
+	return retval;
+}
+
+//@function: add a pool chunk of size - p_bkt->size timers.
+static int grow_timer_pool(timer_bucket_t *p_bkt, int size)
+{
+	ltimer_t *p_timer;
+	pool_chunk_t *p_chunk = (pool_chunk_t *)calloc(1, sizeof(pool_chunk_t) + (size_t)(size - p_bkt->size) * sizeof(ltimer_t));
+	if (NULL == p_chunk) {
+		printf("%s: calloc failed!\n", __func__);
+		return -1;
+	}
+
+	pthread_spin_lock(&p_bkt->splock);
+	//slots never handed out of latest chunk go to recycle list, allocation moves on to new chunk.
+	while (p_bkt->cur_alloc_ptr < p_bkt->end_alloc_ptr) {
+		p_timer = (ltimer_t *)p_bkt->cur_alloc_ptr;
+		list_add_tail(&p_timer->node.entry, &p_bkt->recycle_list);
+		p_bkt->cur_alloc_ptr += sizeof(ltimer_t);
+	}
+	p_chunk->next = p_bkt->chunks;
+	p_bkt->chunks = p_chunk;
+	p_bkt->cur_alloc_ptr = (char *)(p_chunk + 1);
+	p_bkt->end_alloc_ptr = p_bkt->cur_alloc_ptr + (size_t)(size - p_bkt->size) * sizeof(ltimer_t);
+	p_bkt->size = size;
+	pthread_spin_unlock(&p_bkt->splock);
+	return 0;
+}
+
+static void free_timer_pool(timer_bucket_t *p_bkt)
+{
+	pool_chunk_t *p_chunk;
+	while (NULL != (p_chunk = p_bkt->chunks)) {
+		p_bkt->chunks = p_chunk->next;
+		free(p_chunk);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------
+TimerBucketID_t create_timer_bucket(const char *name, int size, int cpuid, struct timespec resolution)
+{
+	return create_timer_bucket_ex(name, size, cpuid, resolution, 0);
+}
+
+TimerBucketID_t create_timer_bucket_ex(const char *name, int size, int cpuid, struct timespec resolution, int flags)
+{
+	if (size < 0 || cpuid < 0
+		|| resolution.tv_sec < 0 || resolution.tv_nsec < 0
+		|| (resolution.tv_sec == 0 && resolution.tv_nsec == 0)
+		|| (flags & ~(LTIMER_BKT_F_VIRTUAL | LTIMER_BKT_F_IOURING | LTIMER_BKT_F_HEAP | LTIMER_BKT_F_WHEEL
+					  | LTIMER_BKT_F_SPREAD))
+		|| ((flags & LTIMER_BKT_F_HEAP) && (flags & LTIMER_BKT_F_WHEEL))) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	int retval = 0;
+	timer_bucket_t *p_bkt = (timer_bucket_t *)calloc(sizeof(timer_bucket_t), 1);
+	if (NULL == p_bkt) {
+		printf("%s: calloc failed!\n", __func__);
+		return -1;
+	}
+	p_bkt->chunks = (pool_chunk_t *)calloc(1, sizeof(pool_chunk_t) + (size_t)size * sizeof(ltimer_t));
+	if (NULL == p_bkt->chunks) {
+		printf("%s: calloc failed!\n", __func__);
+		retval = -1;
+		goto cleanup;
+	}
+
+	if (NULL != name) {
+		snprintf(p_bkt->name, sizeof(p_bkt->name), "%s", name);
+	}
+
+	if (flags & LTIMER_BKT_F_HEAP) {
+		p_bkt->tq.ops = &g_tq_heap_ops;
+	} else if (flags & LTIMER_BKT_F_WHEEL) {
+		p_bkt->tq.ops = &g_tq_wheel_ops;
+	} else {
+		p_bkt->tq.ops = &g_tq_list_ops;
+	}
+	p_bkt->tq.tick = timespec_to_ns(resolution);
+	if (0 != p_bkt->tq.ops->init(&p_bkt->tq, size)) {
+		p_bkt->tq.ops = NULL;
+		retval = -1;
+		goto cleanup;
+	}
+	p_bkt->tq_hi.ops = &g_tq_heap_ops;
+	if (0 != p_bkt->tq_hi.ops->init(&p_bkt->tq_hi, 0)) {
+		p_bkt->tq_hi.ops = NULL;
+		retval = -1;
+		goto cleanup;
+	}
+	list_init(&p_bkt->recycle_list);
+	pthread_spin_init(&p_bkt->splock, 0);
+	p_bkt->cur_alloc_ptr = (char *)(p_bkt->chunks + 1);
+	p_bkt->end_alloc_ptr = p_bkt->cur_alloc_ptr + (size_t)size * sizeof(ltimer_t);
+	p_bkt->resolution = resolution;
+	p_bkt->size = size;
+	p_bkt->cpuid = cpuid;
+	p_bkt->trigger = 1;
+	p_bkt->count = 0;
+	init_timestr(&p_bkt->timestr);
+	p_bkt->summary.width = summary_width(resolution);
+	p_bkt->flags = flags;
+	p_bkt->prng = ((uint64_t)(uintptr_t)p_bkt * 0x9E3779B97F4A7C15ULL) ^ (uint64_t)clock();
+	if (0 == p_bkt->prng) {
+		p_bkt->prng = 0x9E3779B97F4A7C15ULL;
+	}
+
+	//virtual bucket, no work thread, time only moves by bucket_advance.
+	if (flags & LTIMER_BKT_F_VIRTUAL) {
+		refresh_timestr(&p_bkt->timestr, p_bkt->curtime);
+		return (TimerBucketID_t)p_bkt;
+	}
+
+	p_bkt->timerfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK);
+	if (p_bkt->timerfd < 0) {
+		printf("%s: timerfd_create failed with error info: %s!\n", __func__, strerror(errno));
+		retval = -1;
+		goto cleanup;
+	}
+
+	retval = pipe2(p_bkt->pipefd, O_NONBLOCK);
+	if (0 != retval) {
+		printf("%s: pipe2 failed with error info: %s!\n", __func__, strerror(errno));
+		goto cleanup;
+	}
+
+	p_bkt->epoll_fd = epoll_create(MAX_EVENT_NUMBER);
+	if (p_bkt->epoll_fd < 0) {
+		printf("%s: epoll_create failed with error info: %s\n", __func__, strerror(errno));
+		retval = -1;
+		goto cleanup;
+	}
+
+	//io_uring worker on request, fall back to epoll worker when io_uring is unavailable.
+	if (flags & LTIMER_BKT_F_IOURING) {
+		p_bkt->uring = (uring_worker_t *)calloc(sizeof(uring_worker_t), 1);
+		if (NULL != p_bkt->uring && 0 != uring_init(&p_bkt->uring->ring, URING_ENTRIES)) {
+			free(p_bkt->uring);
+			p_bkt->uring = NULL;
+		}
+		if (NULL != p_bkt->uring) {
+			pthread_spin_init(&p_bkt->uring->olock, 0);
+			//doorbell read blocks in kernel, io_uring fails it with EAGAIN on a nonblocking pipe.
+			fcntl(p_bkt->pipefd[0], F_SETFL, fcntl(p_bkt->pipefd[0], F_GETFL) & ~O_NONBLOCK);
+		}
+		if (NULL == p_bkt->uring) {
+			printf("%s: io_uring unavailable, use epoll worker!\n", __func__);
+			p_bkt->flags &= ~LTIMER_BKT_F_IOURING;
+		}
+	}
+
+	retval = pthread_create(&p_bkt->thread_id, NULL,
+							(NULL != p_bkt->uring) ? uring_work_routine : work_routine, (void*)p_bkt);
+	if (retval != 0) {
+		printf("%s: pthread_create failed with error info: %s!\n", __func__, strerror(errno));
+		retval = -1;
+		goto cleanup;
+	}
+
+	//wait for working thread update curtime.
+	while (0 == p_bkt->curtime.tv_sec) {
+		usleep(10);
+	}
+
+	return (TimerBucketID_t)p_bkt;
+
+cleanup:
+	pthread_spin_destroy(&p_bkt->splock);
+	if (NULL != p_bkt->tq.ops) {
+		p_bkt->tq.ops->fini(&p_bkt->tq);
+	}
+	if (NULL != p_bkt->tq_hi.ops) {
+		p_bkt->tq_hi.ops->fini(&p_bkt->tq_hi);
+	}
+	if (NULL != p_bkt->uring) {
+		uring_exit(&p_bkt->uring->ring);
+		pthread_spin_destroy(&p_bkt->uring->olock);
+		free(p_bkt->uring);
+		p_bkt->uring = NULL;
+	}
+	free_timer_pool(p_bkt);
+	if (0 != p_bkt->timerfd) {
+		close(p_bkt->timerfd);
+		p_bkt->timerfd = 0;
+	}
+	if (0 != p_bkt->pipefd[0]) {
+		close(p_bkt->pipefd[0]);
+		p_bkt->pipefd[0] = 0;
+		close(p_bkt->pipefd[1]);
+		p_bkt->pipefd[1] = 0;
+	}
+	if (0 != p_bkt->epoll_fd) {
+		close(p_bkt->epoll_fd);
+		p_bkt->epoll_fd = 0;
+	}
+	if (NULL != p_bkt) {
+		free(p_bkt);
+		p_bkt = NULL;
+	}
+	return -1;
+}
+
+void destroy_timer_bucket(TimerBucketID_t bktid)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+
+	p_bkt->trigger = 0;
+	if (!(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)) {
+		//wake work thread now rather than on its next tick, which may be far away.
+		ltimer_opt_t optev;
+		memset(&optev, 0, sizeof(ltimer_opt_t));
+		optev.opt = EN_TIMER_OPT_STOP;
+		if (0 != post_timer_opt(p_bkt, &optev)) {
+			printf("%s: write pipe error, wait for next tick!\n", __func__);
+		}
+		pthread_join(p_bkt->thread_id, NULL);
+	}
+	if (NULL != p_bkt->recorder) {
+		recorder_destroy(p_bkt->recorder);
+		p_bkt->recorder = NULL;
+	}
+	p_bkt->tq.ops->fini(&p_bkt->tq);
+	p_bkt->tq_hi.ops->fini(&p_bkt->tq_hi);
+	if (NULL != p_bkt->uring) {
+		uring_exit(&p_bkt->uring->ring);
+		pthread_spin_destroy(&p_bkt->uring->olock);
+		free(p_bkt->uring);
+		p_bkt->uring = NULL;
+	}
+	pthread_spin_destroy(&p_bkt->splock);
+	if (0 != p_bkt->timerfd) {
+		close(p_bkt->timerfd);
+		p_bkt->timerfd = 0;
+	}
+	if (0 != p_bkt->pipefd[0]) {
+		close(p_bkt->pipefd[0]);
+		p_bkt->pipefd[0] = 0;
+		close(p_bkt->pipefd[1]);
+		p_bkt->pipefd[1] = 0;
+	}
+	if (0 != p_bkt->epoll_fd) {
+		close(p_bkt->epoll_fd);
+		p_bkt->epoll_fd = 0;
+	}
+	free_timer_pool(p_bkt);
+	free(p_bkt);
+}
+
+int reconfigure_timer_bucket(TimerBucketID_t bktid, int size, int cpuid, struct timespec resolution)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || (0 != size && size < p_bkt->size) || cpuid < -1
+		|| resolution.tv_sec < 0 || resolution.tv_nsec < 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	int nret = 0;
+	ltimer_opt_t optev;
+	bucket_reconf_t rc;
+
+	if (size > p_bkt->size && 0 != grow_timer_pool(p_bkt, size)) {
+		return -1;
+	}
+	if (-1 == cpuid && 0 == resolution.tv_sec && 0 == resolution.tv_nsec) {
+		return 0;
+	}
+
+	memset(&rc, 0, sizeof(bucket_reconf_t));
+	rc.resolution = resolution;
+	rc.cpuid = cpuid;
+
+	//virtual bucket or called from callback on work thread: apply directly.
+	if ((p_bkt->flags & LTIMER_BKT_F_VIRTUAL) || pthread_equal(pthread_self(), p_bkt->thread_id)) {
+		return reconf_bucket(p_bkt, &rc);
+	}
+
+	memset(&optev, 0, sizeof(ltimer_opt_t));
+	optev.opt = EN_TIMER_OPT_RECONF;
+	optev.data = (void *)&rc;
+	nret = post_timer_opt(p_bkt, &optev);
+	if (0 != nret) {
+		printf("%s: write pipe error!\n", __func__);
+		return -1;
+	}
+
+	//wait for work thread, rc lives on this stack.
+	while (0 == rc.done) {
+		sched_yield();
+	}
+	return rc.result;
+}
+
+static inline int valid_timer_type(int type)
+{
+	return ((type & ~LTIMER_TYPE_FLAGS) == 0 || (type & ~LTIMER_TYPE_FLAGS) == 1)
+		&& !(type & LTIMER_TYPE_FLAGS & ~(LTIMER_F_HIGHPRIO | LTIMER_F_SPREAD | LTIMER_F_PREFETCH_DATA));
+}
+
+//@function: take a timer from bucket pool and post it to work thread.
+//@param p_cq: completion queue to deliver expiry to, NULL to call func.
+static TimerID_t add_pool_timer(timer_bucket_t *p_bkt, struct timespec tm, time_out_proc func, void *data, int type,
+								timer_cq_t *p_cq)
+{
+	int nret = 0;
+	ltimer_opt_t optev;
+	ltimer_t *p_timer = NULL;
 
 	//get new timer from recycle_list or resource pool.
 	pthread_spin_lock(&p_bkt->splock);
 	if (!list_empty(&p_bkt->recycle_list)) {
-		p_timer = (ltimer_t *) list_entry(p_bkt->recycle_list.next, ltimer_t, entry);
+		p_timer = (ltimer_t *) list_entry(p_bkt->recycle_list.next, ltimer_t, node.entry);
 		list_del(p_bkt->recycle_list.next);
-	} else if ((int)((p_bkt->cur_alloc_ptr - p_bkt->mem_alloc_ptr) / sizeof(ltimer_t)) < p_bkt->size) {
+	} else if (p_bkt->cur_alloc_ptr < p_bkt->end_alloc_ptr) {
 		p_timer = (ltimer_t *)p_bkt->cur_alloc_ptr;
 		p_bkt->cur_alloc_ptr += sizeof(ltimer_t);
 	}
@@ -432,21 +1694,34 @@ TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc fun
 	}
 
 	//init timer.
-	list_init(&p_timer->entry);
+	tq_node_init(&p_timer->node);
 	p_timer->p_bkt = p_bkt;
 	p_timer->period = tm;
 	p_timer->func = func;
 	p_timer->data = data;
-	p_timer->type = type;
+	p_timer->type = type & ~LTIMER_TYPE_FLAGS;
+	p_timer->flags = (type & LTIMER_F_HIGHPRIO) ? TIMER_F_HIGHPRIO : 0;
+	if ((type & LTIMER_F_SPREAD) || ((p_bkt->flags & LTIMER_BKT_F_SPREAD) && 0 != p_timer->type)) {
+		p_timer->flags |= TIMER_F_SPREAD;
+	}
+	if (type & LTIMER_F_PREFETCH_DATA) {
+		p_timer->flags |= TIMER_F_PREFETCH;
+	}
+	if (NULL != p_cq) {
+		p_timer->flags |= TIMER_F_CQ;
+	}
+	p_timer->cq = p_cq;
+	p_timer->state = 0;
 
-	//write add event to pipe.
+	//post add event to work thread.
 	memset(&optev, 0, sizeof(ltimer_opt_t));
 	optev.opt = EN_TIMER_OPT_ADD;
 	optev.id = (TimerID_t)p_timer;
 
-	//writing bytes less than PIPE_BUF is atomic operation is guaranteed by system.
-	nret = write(p_bkt->pipefd[1], &optev, sizeof(ltimer_opt_t));
-	if (nret != sizeof(ltimer_opt_t)) {
+	record_timer_opt(p_bkt, EN_LTIMER_REC_ADD, p_timer, tm, type);
+	LTIMER_PROBE3(add, p_timer, timespec_to_ns(tm), type);
+	nret = submit_timer_opt(p_bkt, &optev);
+	if (0 != nret) {
 		printf("%s: write pipe error!\n", __func__);
 		goto cleanup;
 	}
@@ -454,12 +1729,21 @@ TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc fun
 	return (TimerID_t)p_timer;
 
 cleanup:
-	pthread_spin_lock(&p_bkt->splock);
-	list_add_head(&p_timer->entry, &p_bkt->recycle_list);
-	pthread_spin_unlock(&p_bkt->splock);
+	putback_timer(p_bkt, p_timer);
 	return -1;
 }
 
+TimerID_t add_timer(TimerBucketID_t bktid, struct timespec tm, time_out_proc func, void *data, int type)
+{
+	if (bktid == 0
+		|| tm.tv_sec < 0 || tm.tv_nsec < 0 || (tm.tv_sec == 0 && tm.tv_nsec == 0)
+		|| NULL == func || NULL == data || !valid_timer_type(type)) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	return add_pool_timer((timer_bucket_t *)bktid, tm, func, data, type, NULL);
+}
+
 int mod_timer(TimerID_t timerid, struct timespec tm, time_out_proc func, void *data)
 {
 	ltimer_t *p_timer = (ltimer_t *)timerid;
@@ -485,8 +1769,10 @@ int mod_timer(TimerID_t timerid, struct timespec tm, time_out_proc func, void *d
 		optev.data = data;
 	}
 
-	nret = write(p_bkt->pipefd[1], &optev, sizeof(ltimer_opt_t));
-	if (nret != sizeof(ltimer_opt_t)) {
+	record_timer_opt(p_bkt, EN_LTIMER_REC_MOD, p_timer, optev.period, 0);
+	LTIMER_PROBE2(mod, p_timer, timespec_to_ns(optev.period));
+	nret = (p_timer->flags & TIMER_F_EXTERN) ? post_timer_opt(p_bkt, &optev) : submit_timer_opt(p_bkt, &optev);
+	if (0 != nret) {
 		printf("%s: write pipe error!\n", __func__);
 		return -1;
 	}
@@ -501,21 +1787,106 @@ int del_timer(TimerID_t timerid)
 		return -1;
 	}
 
-	int nret = 0;
 	ltimer_opt_t optev;
 	timer_bucket_t *p_bkt = (timer_bucket_t *)p_timer->p_bkt;
 
+	//cancel takes effect at once, work thread unlinks the timer when it meets it on expiry.
+	if (-1 == cancel_timer(p_timer)) {
+		return 0;
+	}
 	memset(&optev, 0, sizeof(ltimer_opt_t));
 	optev.opt = EN_TIMER_OPT_DEL;
 	optev.id = timerid;
-	nret = write(p_bkt->pipefd[1], &optev, sizeof(ltimer_opt_t));
-	if (nret != sizeof(ltimer_opt_t)) {
-		printf("%s: write pipe error!\n", __func__);
+	record_timer_opt(p_bkt, EN_LTIMER_REC_DEL, p_timer, optev.period, 0);
+	LTIMER_PROBE1(del, p_timer);
+
+	//hint work thread to give slot back earlier, nobody waits on it, lost hint only delays reclaim.
+	if (p_timer->flags & TIMER_F_EXTERN) {
+		post_timer_opt(p_bkt, &optev);
+	} else {
+		submit_timer_opt(p_bkt, &optev);
+	}
+	return 0;
+}
+
+int del_timer_sync(TimerID_t timerid)
+{
+	ltimer_t *p_timer = (ltimer_t *)timerid;
+	if (NULL == p_timer || NULL == p_timer->p_bkt) {
+		printf("%s: Invalid timer id!\n", __func__);
+		return -1;
+	}
+
+	timer_bucket_t *p_bkt = (timer_bucket_t *)p_timer->p_bkt;
+
+	//extern node stays RUNNING after its last run, its owner may release it inside func,
+	//so its state can't tell whether func is still running, the work thread can.
+	if (p_timer->flags & TIMER_F_EXTERN) {
+		return del_timer_node(timerid);
+	}
+
+	if (0 != del_timer(timerid)) {
+		return -1;
+	}
+
+	//called from a callback of this bucket, waiting would never end.
+	if ((p_bkt->flags & LTIMER_BKT_F_VIRTUAL) || pthread_equal(pthread_self(), p_bkt->thread_id)) {
+		return 0;
+	}
+
+	//no new run starts after cancel, wait out the one in progress.
+	//pool memory stays valid, so state can be polled even after the slot is recycled.
+	while (__atomic_load_n(&p_timer->state, __ATOMIC_ACQUIRE) & TIMER_ST_RUNNING) {
+		sched_yield();
+	}
+	return 0;
+}
+
+int ltimer_batch_start(int threshold)
+{
+	if (threshold <= 0 || threshold > OPT_READ_BATCH) {
+		printf("%s: Invalid parameter!\n", __func__);
 		return -1;
 	}
+
+	if (NULL == t_batch) {
+		pthread_once(&g_batch_once, batch_key_create);
+		t_batch = (opt_batch_t *)calloc(sizeof(opt_batch_t), 1);
+		if (NULL == t_batch) {
+			printf("%s: calloc failed!\n", __func__);
+			return -1;
+		}
+		pthread_setspecific(g_batch_key, t_batch);
+	}
+	t_batch->threshold = threshold;
+	if (t_batch->count >= threshold) {
+		return flush_opt_batch(t_batch);
+	}
 	return 0;
 }
 
+int ltimer_batch_stop(void)
+{
+	opt_batch_t *p_batch = t_batch;
+	if (NULL == p_batch) {
+		return 0;
+	}
+
+	int retval = flush_opt_batch(p_batch);
+	pthread_setspecific(g_batch_key, NULL);
+	t_batch = NULL;
+	free(p_batch);
+	return retval;
+}
+
+int ltimer_flush(void)
+{
+	if (NULL == t_batch) {
+		return 0;
+	}
+	return flush_opt_batch(t_batch);
+}
+
 const struct timespec* curtime(struct timespec* pts)
 {
 	if (NULL != pts) {
@@ -528,6 +1899,358 @@ const struct timespec* curtime(struct timespec* pts)
 
 const char* curtime_str(char *timestr, int size)
 {
+	char str[TIMESTR_SIZE];
 	time_t tm = (time_t)g_sys_curtime.tv_sec;
-	return (const char*)ctime_r(&tm, timestr);
+	if (NULL == timestr || size <= 0 || NULL == ctime_r(&tm, str)) {
+		return NULL;
+	}
+	snprintf(timestr, size, "%s", str);
+	return (const char*)timestr;
+}
+
+int curtime_fmt(TimerBucketID_t bktid, int fmt, char *buf, int size)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || fmt < 0 || fmt >= LTIMER_FMT_NUM || NULL == buf || size <= 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	int len;
+	unsigned seq;
+	timestr_cache_t *p_cache = &p_bkt->timestr;
+
+	do {
+		seq = __atomic_load_n(&p_cache->seq, __ATOMIC_ACQUIRE);
+		len = p_cache->len[seq & 1][fmt];
+		if (len > size - 1) {
+			len = size - 1;
+		}
+		memcpy(buf, p_cache->str[seq & 1][fmt], len);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (seq != __atomic_load_n(&p_cache->seq, __ATOMIC_RELAXED));
+	buf[len] = '\0';
+	return len;
+}
+
+TimerID_t add_timer_node(TimerBucketID_t bktid, ltimer_node_t *node, struct timespec tm, time_out_proc func, void *data)
+{
+	if (bktid == 0 || NULL == node
+		|| tm.tv_sec < 0 || tm.tv_nsec < 0 || (tm.tv_sec == 0 && tm.tv_nsec == 0)
+		|| NULL == func || NULL == data) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	int nret = 0;
+	ltimer_opt_t optev;
+	ltimer_t *p_timer = (ltimer_t *)node;
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+
+	//init timer, node memory is owned by caller.
+	tq_node_init(&p_timer->node);
+	p_timer->p_bkt = p_bkt;
+	p_timer->period = tm;
+	p_timer->func = func;
+	p_timer->data = data;
+	p_timer->type = 0;
+	p_timer->flags = TIMER_F_EXTERN;
+	p_timer->state = 0;
+
+	memset(&optev, 0, sizeof(ltimer_opt_t));
+	optev.opt = EN_TIMER_OPT_ADD;
+	optev.id = (TimerID_t)p_timer;
+	record_timer_opt(p_bkt, EN_LTIMER_REC_ADD, p_timer, tm, 0);
+	LTIMER_PROBE3(add, p_timer, timespec_to_ns(tm), 0);
+	nret = post_timer_opt(p_bkt, &optev);
+	if (0 != nret) {
+		printf("%s: write pipe error!\n", __func__);
+		p_timer->p_bkt = NULL;
+		return -1;
+	}
+	return (TimerID_t)p_timer;
+}
+
+int del_timer_node(TimerID_t timerid)
+{
+	ltimer_t *p_timer = (ltimer_t *)timerid;
+	if (NULL == p_timer || NULL == p_timer->p_bkt) {
+		printf("%s: Invalid timer id!\n", __func__);
+		return -1;
+	}
+
+	int nret = 0;
+	volatile int done = 0;
+	ltimer_opt_t optev;
+	timer_bucket_t *p_bkt = (timer_bucket_t *)p_timer->p_bkt;
+
+	//func won't run from here on, the node still has to be unlinked before its memory goes.
+	cancel_timer(p_timer);
+	memset(&optev, 0, sizeof(ltimer_opt_t));
+	record_timer_opt(p_bkt, EN_LTIMER_REC_DEL, p_timer, optev.period, 0);
+	LTIMER_PROBE1(del, p_timer);
+
+	//virtual bucket or called from callback on work thread: apply pending events first, then unlink directly.
+	if ((p_bkt->flags & LTIMER_BKT_F_VIRTUAL) || pthread_equal(pthread_self(), p_bkt->thread_id)) {
+		if (!(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)) {
+			drain_timer_opt_event(p_bkt);
+		}
+		if (tq_node_queued(&p_timer->node)) {
+			dequeue_timer(p_bkt, p_timer);
+			recycle_timer(p_bkt, p_timer);
+		} else {
+			unbatch_timer(p_bkt, p_timer);
+		}
+		p_timer->p_bkt = NULL;
+		return 0;
+	}
+
+	optev.opt = EN_TIMER_OPT_DEL_SYNC;
+	optev.id = timerid;
+	optev.data = (void *)&done;
+	nret = post_timer_opt(p_bkt, &optev);
+	if (0 != nret) {
+		printf("%s: write pipe error!\n", __func__);
+		return -1;
+	}
+
+	//wait for work thread, node memory may be released by caller after return.
+	while (0 == done) {
+		sched_yield();
+	}
+	p_timer->p_bkt = NULL;
+	return 0;
+}
+
+int bucket_advance(TimerBucketID_t bktid, struct timespec tm)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || !(p_bkt->flags & LTIMER_BKT_F_VIRTUAL)
+		|| tm.tv_sec < 0 || tm.tv_nsec < 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	int nfired = 0;
+	int64_t nticks, nskip, gap;
+	int64_t tick = timespec_to_ns(p_bkt->resolution);
+	tq_node_t *p_head = NULL;
+
+	p_bkt->vclock_frac += timespec_to_ns(tm);
+
+	//expired timers left over by budget are fired first, clock stays until they are all gone.
+	if (p_bkt->carry) {
+		nfired += check_timers_in_bucket(p_bkt);
+		publish_summary(p_bkt);
+		if (NULL != p_bkt->recorder) {
+			recorder_flush(p_bkt->recorder);
+		}
+		if (p_bkt->carry) {
+			return nfired;
+		}
+	}
+	nticks = p_bkt->vclock_frac / tick;
+	p_bkt->vclock_frac %= tick;
+
+	//jump straight to the tick where next timer expires, so idle time costs nothing.
+	while (nticks > 0) {
+		nskip = nticks;
+		p_head = peek_next_timer(p_bkt);
+		if (NULL != p_head) {
+			gap = p_head->key - timespec_to_ns(p_bkt->curtime);
+			if (gap <= 0) {
+				nskip = 1;
+			} else if ((gap + tick - 1) / tick < nticks) {
+				nskip = (gap + tick - 1) / tick;
+			}
+		}
+		advance_curtime(p_bkt, nskip);
+		refresh_timestr(&p_bkt->timestr, p_bkt->curtime);
+		nticks -= nskip;
+		nfired += check_timers_in_bucket(p_bkt);
+		publish_summary(p_bkt);
+		if (NULL != p_bkt->recorder) {
+			recorder_flush(p_bkt->recorder);
+		}
+		//budget ran out, rest of time waits for next call.
+		if (p_bkt->carry) {
+			p_bkt->vclock_frac += nticks * tick;
+			break;
+		}
+	}
+	return nfired;
+}
+
+const struct timespec* bucket_curtime(TimerBucketID_t bktid, struct timespec* pts)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL != pts) {
+		pts->tv_sec = p_bkt->curtime.tv_sec;
+		pts->tv_nsec = p_bkt->curtime.tv_nsec;
+		return pts;
+	}
+	return &p_bkt->curtime;
+}
+
+TimerCQID_t create_timer_cq(TimerBucketID_t bktid, int size)
+{
+	if (bktid == 0 || size <= 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	timer_cq_t *p_cq = timer_cq_create(size);
+	if (NULL == p_cq) {
+		return -1;
+	}
+	p_cq->p_bkt = (void *)bktid;
+	return (TimerCQID_t)p_cq;
+}
+
+void destroy_timer_cq(TimerCQID_t cqid)
+{
+	timer_cq_destroy((timer_cq_t *)cqid);
+}
+
+int timer_cq_fd(TimerCQID_t cqid)
+{
+	timer_cq_t *p_cq = (timer_cq_t *)cqid;
+	if (NULL == p_cq) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	return p_cq->efd;
+}
+
+TimerID_t add_timer_cq(TimerCQID_t cqid, struct timespec tm, void *data, int type)
+{
+	timer_cq_t *p_cq = (timer_cq_t *)cqid;
+	if (NULL == p_cq
+		|| tm.tv_sec < 0 || tm.tv_nsec < 0 || (tm.tv_sec == 0 && tm.tv_nsec == 0)
+		|| !valid_timer_type(type)) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	return add_pool_timer((timer_bucket_t *)p_cq->p_bkt, tm, NULL, data, type, p_cq);
+}
+
+int drain_timer_cq(TimerCQID_t cqid, ltimer_cqe_t *cqes, int max)
+{
+	timer_cq_t *p_cq = (timer_cq_t *)cqid;
+	if (NULL == p_cq || NULL == cqes || max <= 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	return timer_cq_drain(p_cq, cqes, max);
+}
+
+int bucket_set_budget(TimerBucketID_t bktid, int count, struct timespec tm)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || count < 0 || tm.tv_sec < 0 || tm.tv_nsec < 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	__atomic_store_n(&p_bkt->budget_count, count, __ATOMIC_RELAXED);
+	__atomic_store_n(&p_bkt->budget_ns, timespec_to_ns(tm), __ATOMIC_RELAXED);
+	return 0;
+}
+
+int bucket_set_spread(TimerBucketID_t bktid, struct timespec phase, struct timespec jitter)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || phase.tv_sec < 0 || phase.tv_nsec < 0 || jitter.tv_sec < 0 || jitter.tv_nsec < 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	__atomic_store_n(&p_bkt->spread_phase, timespec_to_ns(phase), __ATOMIC_RELAXED);
+	__atomic_store_n(&p_bkt->spread_jitter, timespec_to_ns(jitter), __ATOMIC_RELAXED);
+	return 0;
+}
+
+int bucket_next_expiry(TimerBucketID_t bktid, struct timespec *pts)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || NULL == pts) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	unsigned seq;
+	int64_t head;
+	do {
+		if (0 == (seq = begin_summary_read(p_bkt))) {
+			errno = EAGAIN;
+			return -1;
+		}
+		head = p_bkt->summary.head;
+	} while (!end_summary_read(p_bkt, seq));
+
+	if (INT64_MAX == head) {
+		return 0;
+	}
+	pts->tv_sec = (time_t)(head / 1000000000);
+	pts->tv_nsec = (long)(head % 1000000000);
+	return 1;
+}
+
+long bucket_count_expiring(TimerBucketID_t bktid, struct timespec window)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || window.tv_sec < 0 || window.tv_nsec < 0) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	unsigned seq;
+	int64_t i;
+	long count;
+	expiry_summary_t *p_sum = &p_bkt->summary;
+
+	//window end rounds up to slot boundary, clamps to summary horizon.
+	do {
+		if (0 == (seq = begin_summary_read(p_bkt))) {
+			errno = EAGAIN;
+			return -1;
+		}
+		i = (p_sum->now + timespec_to_ns(window) - p_sum->base + p_sum->width - 1) / p_sum->width - 1;
+		if (i < 0) {
+			i = 0;
+		} else if (i >= SUMMARY_SLOTS) {
+			i = SUMMARY_SLOTS - 1;
+		}
+		count = p_sum->count[i];
+	} while (!end_summary_read(p_bkt, seq));
+	return count;
+}
+
+int bucket_record_start(TimerBucketID_t bktid, const char *path)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || NULL == path) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+
+	//recorder lives until bucket is destroyed, producers never see it released.
+	if (NULL == p_bkt->recorder) {
+		recorder_t *p_rec = recorder_create();
+		if (NULL == p_rec) {
+			return -1;
+		}
+		if (!__sync_bool_compare_and_swap(&p_bkt->recorder, NULL, p_rec)) {
+			recorder_destroy(p_rec);
+		}
+	}
+	return recorder_start(p_bkt->recorder, path, timespec_to_ns(p_bkt->resolution));
+}
+
+long bucket_record_stop(TimerBucketID_t bktid)
+{
+	timer_bucket_t *p_bkt = (timer_bucket_t *)bktid;
+	if (NULL == p_bkt || NULL == p_bkt->recorder) {
+		printf("%s: Invalid parameter!\n", __func__);
+		return -1;
+	}
+	return (long)recorder_stop(p_bkt->recorder);
 }
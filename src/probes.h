@@ -0,0 +1,50 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+//USDT probes (provider "ltimer"), a nop instruction each when no tracer is attached.
+//built in when <sys/sdt.h> is found (systemtap-sdt-dev), define LTIMER_NO_USDT to leave them out.
+//
+//  ltimer:add(timer, period_ns, type)
+//  ltimer:mod(timer, period_ns)
+//  ltimer:del(timer)
+//  ltimer:opt_batch(bucket, nevents)			events applied by one pipe read.
+//  ltimer:fire(timer, expire_ns, lateness_ns)	lateness against bucket tick time.
+//  ltimer:tick(bucket, nticks, nfired, lateness_ns)	lateness of tick against wall clock,
+//												only measured while a tracer is attached.
+//
+//sample bpftrace scripts are in scripts/.
+
+#if !defined(LTIMER_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define LTIMER_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef LTIMER_HAVE_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define LTIMER_PROBE_SEMAPHORE(name) \
+	unsigned short ltimer_##name##_semaphore __attribute__((unused, section(".probes")))
+#define LTIMER_PROBE_ENABLED(name)	__builtin_expect(ltimer_##name##_semaphore, 0)
+
+#define LTIMER_PROBE1(name, a1)					STAP_PROBE1(ltimer, name, a1)
+#define LTIMER_PROBE2(name, a1, a2)				STAP_PROBE2(ltimer, name, a1, a2)
+#define LTIMER_PROBE3(name, a1, a2, a3)			STAP_PROBE3(ltimer, name, a1, a2, a3)
+#define LTIMER_PROBE4(name, a1, a2, a3, a4)		STAP_PROBE4(ltimer, name, a1, a2, a3, a4)
+
+#else
+
+#define LTIMER_PROBE_SEMAPHORE(name)	struct ltimer_##name##_semaphore_unused
+#define LTIMER_PROBE_ENABLED(name)		0
+
+//arguments are type checked but never evaluated.
+#define LTIMER_PROBE1(name, a1)					do { if (0) { (void)(a1); } } while (0)
+#define LTIMER_PROBE2(name, a1, a2)				do { if (0) { (void)(a1); (void)(a2); } } while (0)
+#define LTIMER_PROBE3(name, a1, a2, a3)			do { if (0) { (void)(a1); (void)(a2); (void)(a3); } } while (0)
+#define LTIMER_PROBE4(name, a1, a2, a3, a4)		do { if (0) { (void)(a1); (void)(a2); (void)(a3); (void)(a4); } } while (0)
+
+#endif //LTIMER_HAVE_USDT
+
+#endif //PROBES_H
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "recorder.h"
+
+#define RECORD_FLUSH_BATCH	256
+
+recorder_t* recorder_create(void)
+{
+	uint64_t i;
+	recorder_t *p_rec = (recorder_t *)calloc(sizeof(recorder_t), 1);
+	if (NULL == p_rec) {
+		printf("%s: calloc failed!\n", __func__);
+		return NULL;
+	}
+	p_rec->slots = (record_slot_t *)calloc(sizeof(record_slot_t), LTIMER_RECORD_RING_SIZE);
+	if (NULL == p_rec->slots) {
+		printf("%s: calloc failed!\n", __func__);
+		free(p_rec);
+		return NULL;
+	}
+	for (i = 0; i < LTIMER_RECORD_RING_SIZE; i++) {
+		p_rec->slots[i].seq = i;
+	}
+	pthread_mutex_init(&p_rec->lock, NULL);
+	return p_rec;
+}
+
+void recorder_destroy(recorder_t* p_rec)
+{
+	if (NULL == p_rec) {
+		return;
+	}
+	recorder_stop(p_rec);
+	pthread_mutex_destroy(&p_rec->lock);
+	free(p_rec->slots);
+	free(p_rec);
+}
+
+int recorder_start(recorder_t* p_rec, const char *path, int64_t resolution)
+{
+	ltimer_trace_hdr_t hdr;
+
+	//drop records left by producers racing with last stop, they belong to no trace.
+	recorder_flush(p_rec);
+
+	pthread_mutex_lock(&p_rec->lock);
+	if (NULL != p_rec->fp) {
+		pthread_mutex_unlock(&p_rec->lock);
+		printf("%s: already recording!\n", __func__);
+		return -1;
+	}
+	p_rec->fp = fopen(path, "wb");
+	if (NULL == p_rec->fp) {
+		pthread_mutex_unlock(&p_rec->lock);
+		printf("%s: fopen [%s] failed with error info: %s!\n", __func__, path, strerror(errno));
+		return -1;
+	}
+
+	hdr.magic = LTIMER_TRACE_MAGIC;
+	hdr.resolution = resolution;
+	fwrite(&hdr, sizeof(hdr), 1, p_rec->fp);
+
+	p_rec->dropped = 0;
+	__atomic_store_n(&p_rec->enabled, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&p_rec->lock);
+	return 0;
+}
+
+uint64_t recorder_stop(recorder_t* p_rec)
+{
+	__atomic_store_n(&p_rec->enabled, 0, __ATOMIC_RELEASE);
+	recorder_flush(p_rec);
+
+	pthread_mutex_lock(&p_rec->lock);
+	if (NULL != p_rec->fp) {
+		fclose(p_rec->fp);
+		p_rec->fp = NULL;
+	}
+	pthread_mutex_unlock(&p_rec->lock);
+	return __atomic_load_n(&p_rec->dropped, __ATOMIC_RELAXED);
+}
+
+int recorder_put(recorder_t* p_rec, int op, uint64_t handle, int64_t ts, int64_t period, int type)
+{
+	int64_t diff;
+	uint64_t seq;
+	record_slot_t *p_slot;
+	uint64_t pos = __atomic_load_n(&p_rec->head, __ATOMIC_RELAXED);
+
+	//bounded ring, claim a slot by moving head when its sequence says it's free.
+	for (;;) {
+		p_slot = &p_rec->slots[pos & (LTIMER_RECORD_RING_SIZE - 1)];
+		seq = __atomic_load_n(&p_slot->seq, __ATOMIC_ACQUIRE);
+		diff = (int64_t)(seq - pos);
+		if (0 == diff) {
+			if (__atomic_compare_exchange_n(&p_rec->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			__atomic_add_fetch(&p_rec->dropped, 1, __ATOMIC_RELAXED);
+			return -1;
+		} else {
+			pos = __atomic_load_n(&p_rec->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	p_slot->rec.ts = ts;
+	p_slot->rec.period = period;
+	p_slot->rec.handle = handle;
+	p_slot->rec.op = op;
+	p_slot->rec.type = type;
+	__atomic_store_n(&p_slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void recorder_flush(recorder_t* p_rec)
+{
+	int n = 0;
+	record_slot_t *p_slot;
+	ltimer_record_t batch[RECORD_FLUSH_BATCH];
+
+	pthread_mutex_lock(&p_rec->lock);
+	for (;;) {
+		p_slot = &p_rec->slots[p_rec->tail & (LTIMER_RECORD_RING_SIZE - 1)];
+		if (__atomic_load_n(&p_slot->seq, __ATOMIC_ACQUIRE) != p_rec->tail + 1) {
+			break;
+		}
+		batch[n++] = p_slot->rec;
+		__atomic_store_n(&p_slot->seq, p_rec->tail + LTIMER_RECORD_RING_SIZE, __ATOMIC_RELEASE);
+		p_rec->tail++;
+
+		if (RECORD_FLUSH_BATCH == n) {
+			if (NULL != p_rec->fp) {
+				fwrite(batch, sizeof(ltimer_record_t), n, p_rec->fp);
+			}
+			n = 0;
+		}
+	}
+	if (n > 0 && NULL != p_rec->fp) {
+		fwrite(batch, sizeof(ltimer_record_t), n, p_rec->fp);
+	}
+	pthread_mutex_unlock(&p_rec->lock);
+}
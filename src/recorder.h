@@ -0,0 +1,72 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+//workload recorder.
+//timer operations are put into a per-bucket lock-free ring by any thread,
+//work thread flushes the ring to a binary trace file every tick.
+//trace file: one ltimer_trace_hdr_t, then ltimer_record_t until end of file.
+
+#define LTIMER_TRACE_MAGIC		0x31435254524d544cULL	//"LTMRTRC1"
+#define LTIMER_RECORD_RING_SIZE	65536					//must be power of 2.
+
+enum {
+	EN_LTIMER_REC_ADD,
+	EN_LTIMER_REC_DEL,
+	EN_LTIMER_REC_MOD,
+	EN_LTIMER_REC_EXPIRE,
+};
+
+typedef struct st_ltimer_trace_hdr {
+	uint64_t			magic;			//LTIMER_TRACE_MAGIC.
+	int64_t				resolution;		//bucket resolution in ns.
+} ltimer_trace_hdr_t;
+
+typedef struct st_ltimer_record {
+	int64_t				ts;				//bucket time in ns.
+	int64_t				period;			//relative time in ns, 0 if not given.
+	uint64_t			handle;			//timer id.
+	int32_t				op;				//refer to EN_LTIMER_REC_XXX.
+	int32_t				type;			//timer type, valid for add.
+} ltimer_record_t;
+
+typedef struct st_record_slot {
+	uint64_t			seq;			//ring sequence, slot readable when seq == pos + 1.
+	ltimer_record_t		rec;
+} record_slot_t;
+
+typedef struct st_recorder {
+	record_slot_t*		slots;			//ring slots.
+	uint64_t			head;			//next position to write, shared by producers.
+	uint64_t			tail;			//next position to flush, owned by flusher.
+	uint64_t			dropped;		//records dropped on full ring.
+
+	pthread_mutex_t		lock;			//lock for fp and tail.
+	FILE*				fp;				//trace file, NULL when not recording.
+	int					enabled;		//producers record only when set.
+	int					pad;			//padding bytes.
+} recorder_t;
+
+recorder_t* recorder_create(void);
+
+void recorder_destroy(recorder_t* p_rec);
+
+//@function: open trace file and start recording.
+//@return: -1 on error, 0 on success.
+int recorder_start(recorder_t* p_rec, const char *path, int64_t resolution);
+
+//@function: stop recording, flush pending records and close trace file.
+//@return: number of records dropped during recording.
+uint64_t recorder_stop(recorder_t* p_rec);
+
+//@function: put one record, lock free, safe for any thread.
+//@return: -1 if ring is full and record dropped, 0 on success.
+int recorder_put(recorder_t* p_rec, int op, uint64_t handle, int64_t ts, int64_t period, int type);
+
+//@function: write records in ring to trace file.
+void recorder_flush(recorder_t* p_rec);
+
+#endif //RECORDER_H
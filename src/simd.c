@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+#include "simd.h"
+
+static uint64_t expired_mask_scalar(const int64_t *keys, int n, int64_t now)
+{
+	int i;
+	uint64_t mask = 0;
+	for (i = 0; i < n; i++) {
+		mask |= (uint64_t)(keys[i] <= now) << i;
+	}
+	return mask;
+}
+
+#ifdef SIMD_X86
+//sse2 has no 64-bit compare, deadlines and now are non-negative so (now - key) can't overflow,
+//its sign bit tells key > now.
+__attribute__((target("sse2")))
+static uint64_t expired_mask_sse2(const int64_t *keys, int n, int64_t now)
+{
+	int i;
+	uint64_t mask = 0;
+	__m128i vnow = _mm_set1_epi64x(now);
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		__m128i diff = _mm_sub_epi64(vnow, _mm_loadu_si128((const __m128i *)(keys + i)));
+		mask |= (uint64_t)(~_mm_movemask_pd(_mm_castsi128_pd(diff)) & 0x3) << i;
+	}
+	for (; i < n; i++) {
+		mask |= (uint64_t)(keys[i] <= now) << i;
+	}
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t expired_mask_avx2(const int64_t *keys, int n, int64_t now)
+{
+	int i;
+	uint64_t mask = 0;
+	__m256i vnow = _mm256_set1_epi64x(now);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256i later = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(keys + i)), vnow);
+		mask |= (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(later)) & 0xf) << i;
+	}
+	for (; i < n; i++) {
+		mask |= (uint64_t)(keys[i] <= now) << i;
+	}
+	return mask;
+}
+#endif //SIMD_X86
+
+simd_expired_mask_func simd_expired_mask = expired_mask_scalar;
+static const char *g_kernel_name = "scalar";
+
+__attribute__((constructor))
+static void simd_select_kernel(void)
+{
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		simd_expired_mask = expired_mask_avx2;
+		g_kernel_name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		simd_expired_mask = expired_mask_sse2;
+		g_kernel_name = "sse2";
+	}
+#endif
+}
+
+const char* simd_kernel_name(void)
+{
+	return g_kernel_name;
+}
@@ -0,0 +1,19 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+//vector kernels for expiry scan over contiguous deadline arrays.
+//the best kernel for this cpu (avx2, sse2 or scalar) is picked once at load time by cpuid.
+
+//@function: find expired keys of a block.
+//@param n: number of keys, at most 64.
+//@return: bit i set if keys[i] <= now.
+typedef uint64_t (*simd_expired_mask_func)(const int64_t *keys, int n, int64_t now);
+
+extern simd_expired_mask_func simd_expired_mask;
+
+//@function: name of kernel in use, for logs and benchmarks.
+const char* simd_kernel_name(void);
+
+#endif //SIMD_H
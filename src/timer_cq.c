@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "timer_cq.h"
+
+timer_cq_t* timer_cq_create(int size)
+{
+	uint32_t nslots = 1;
+	timer_cq_t *p_cq = NULL;
+
+	while (nslots < (uint32_t)size) {
+		nslots <<= 1;
+	}
+	if (0 != posix_memalign((void **)&p_cq, 64, sizeof(timer_cq_t))) {
+		printf("%s: posix_memalign failed!\n", __func__);
+		return NULL;
+	}
+	memset(p_cq, 0, sizeof(timer_cq_t));
+	p_cq->ring = (ltimer_cqe_t *)calloc(sizeof(ltimer_cqe_t), nslots);
+	if (NULL == p_cq->ring) {
+		printf("%s: calloc failed!\n", __func__);
+		free(p_cq);
+		return NULL;
+	}
+	p_cq->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (p_cq->efd < 0) {
+		printf("%s: eventfd failed with error info: %s!\n", __func__, strerror(errno));
+		free(p_cq->ring);
+		free(p_cq);
+		return NULL;
+	}
+	p_cq->mask = nslots - 1;
+	return p_cq;
+}
+
+void timer_cq_destroy(timer_cq_t* p_cq)
+{
+	if (NULL == p_cq) {
+		return;
+	}
+	close(p_cq->efd);
+	free(p_cq->ring);
+	free(p_cq);
+}
+
+int timer_cq_push(timer_cq_t* p_cq, TimerID_t id, void *data)
+{
+	uint64_t one = 1;
+	uint64_t tail = p_cq->tail;
+	uint64_t head = __atomic_load_n(&p_cq->head, __ATOMIC_ACQUIRE);
+
+	if (tail - head > p_cq->mask) {
+		p_cq->nfull++;
+		return -1;
+	}
+	p_cq->ring[tail & p_cq->mask].id = id;
+	p_cq->ring[tail & p_cq->mask].data = data;
+	__atomic_store_n(&p_cq->tail, tail + 1, __ATOMIC_RELEASE);
+
+	//pairs with fence of consumer: either it sees the new tail, or we see the ring it left empty.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&p_cq->head, __ATOMIC_ACQUIRE) == tail) {
+		if (write(p_cq->efd, &one, sizeof(one)) != sizeof(one) && EAGAIN != errno) {
+			printf("%s: write eventfd failed with error info: %s!\n", __func__, strerror(errno));
+		}
+	}
+	return 0;
+}
+
+int timer_cq_drain(timer_cq_t* p_cq, ltimer_cqe_t *cqes, int max)
+{
+	int n = 0;
+	uint64_t cnt;
+	uint64_t tail, head = p_cq->head;
+
+	//clear wakeup first, entries pushed from now on signal again or are seen below.
+	if (read(p_cq->efd, &cnt, sizeof(cnt)) < 0 && EAGAIN != errno) {
+		printf("%s: read eventfd failed with error info: %s!\n", __func__, strerror(errno));
+	}
+
+	while (n < max) {
+		tail = __atomic_load_n(&p_cq->tail, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			break;
+		}
+		while (head != tail && n < max) {
+			cqes[n++] = p_cq->ring[head++ & p_cq->mask];
+		}
+		__atomic_store_n(&p_cq->head, head, __ATOMIC_RELEASE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+	return n;
+}
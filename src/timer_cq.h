@@ -0,0 +1,36 @@
+#ifndef TIMER_CQ_H
+#define TIMER_CQ_H
+
+#include <stdint.h>
+
+#include "ltimer.h"
+
+//expiry completion queue.
+//single producer (bucket work thread) single consumer ring of expired timers,
+//an eventfd is signalled when an entry lands in an empty ring, consumer drains at its own pace.
+
+typedef struct st_timer_cq {
+	ltimer_cqe_t*		ring;			//ring entries.
+	uint32_t			mask;			//ring size - 1, size is power of 2.
+	int					efd;			//eventfd for wakeup of consumer.
+	void*				p_bkt;			//bucket the queue is bound to.
+
+	uint64_t			head __attribute__((aligned(64)));	//next entry to drain, owned by consumer.
+	uint64_t			tail __attribute__((aligned(64)));	//next entry to fill, owned by producer.
+	uint64_t			nfull;			//pushes refused on full ring.
+} timer_cq_t;
+
+//@param size: entries of ring, rounded up to power of 2.
+timer_cq_t* timer_cq_create(int size);
+
+void timer_cq_destroy(timer_cq_t* p_cq);
+
+//@function: put one entry, producer side.
+//@return: -1 if ring is full, 0 on success.
+int timer_cq_push(timer_cq_t* p_cq, TimerID_t id, void *data);
+
+//@function: take up to max entries, consumer side.
+//@return: number of entries taken.
+int timer_cq_drain(timer_cq_t* p_cq, ltimer_cqe_t *cqes, int max);
+
+#endif //TIMER_CQ_H
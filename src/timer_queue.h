@@ -0,0 +1,67 @@
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#include <stdint.h>
+
+#include "list_head.h"
+
+//timer queue: the structure ordering active timers of a bucket by deadline.
+//backends are chosen per bucket by LTIMER_BKT_F_XXX flags, all calls are made by bucket owner thread.
+//  list: sorted list, O(1) peek/pop, O(n) insert, suits short uniform timeouts inserted in order.
+//  heap: indexed 4-ary min-heap, O(log n) insert/remove/pop, suits sparse mixed deadlines.
+//  wheel: hashed timing wheel of one tick per slot, O(1) insert/remove, slot deadlines kept in a
+//         contiguous array and scanned with vector compare, suits dense slots of short uniform timeouts.
+
+typedef struct st_tq_node {
+	struct list_head	entry;		//list backend link, reused by bucket recycle list when not queued.
+	int64_t				key;		//deadline, abs time in ns.
+	int					idx;		//heap index or wheel slot position, -1 when not queued.
+	int					pad;		//padding bytes.
+} tq_node_t;
+
+typedef struct st_timer_queue timer_queue_t;
+typedef void (*tq_walk_func)(tq_node_t *p_node, void *arg);
+
+typedef struct st_timer_queue_ops {
+	const char*			name;
+	int					(*init)(timer_queue_t *p_tq, int capacity);
+	void				(*fini)(timer_queue_t *p_tq);
+	//@return: -1 on error (no memory), 0 on success.
+	int					(*insert)(timer_queue_t *p_tq, tq_node_t *p_node);
+	//node must be queued.
+	void				(*remove)(timer_queue_t *p_tq, tq_node_t *p_node);
+	//@return: node with min key, NULL if empty.
+	tq_node_t*			(*peek_min)(timer_queue_t *p_tq);
+	//@return: node with min key if key <= now, removed from queue; NULL otherwise.
+	tq_node_t*			(*pop_expired)(timer_queue_t *p_tq, int64_t now);
+	//call func on every node with key < limit, in no particular order, queue must not change meanwhile.
+	void				(*walk_before)(timer_queue_t *p_tq, int64_t limit, tq_walk_func func, void *arg);
+} timer_queue_ops_t;
+
+struct st_timer_queue {
+	const timer_queue_ops_t*	ops;
+	struct list_head	list;		//list backend head.
+	tq_node_t**			heap;		//heap backend array.
+	struct st_tq_wheel*	wheel;		//wheel backend slots.
+	int64_t				tick;		//wheel slot width in ns, bucket resolution.
+	int					capacity;	//heap array size.
+	int					count;		//queued nodes.
+};
+
+extern const timer_queue_ops_t g_tq_list_ops;
+extern const timer_queue_ops_t g_tq_heap_ops;
+extern const timer_queue_ops_t g_tq_wheel_ops;
+
+static inline void tq_node_init(tq_node_t *p_node)
+{
+	list_init(&p_node->entry);
+	p_node->key = 0;
+	p_node->idx = -1;
+}
+
+static inline int tq_node_queued(tq_node_t *p_node)
+{
+	return (p_node->idx >= 0);
+}
+
+#endif //TIMER_QUEUE_H
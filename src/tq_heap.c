@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timer_queue.h"
+
+//indexed 4-ary min-heap backend.
+//every node keeps its heap index, so remove (cancel) is O(log n) without searching.
+//4 children share a cache line of the pointer array, halving the depth of a binary heap.
+
+#define HEAP_ARITY			4
+#define HEAP_MIN_CAPACITY	64
+
+static inline void heap_place(timer_queue_t *p_tq, int idx, tq_node_t *p_node)
+{
+	p_tq->heap[idx] = p_node;
+	p_node->idx = idx;
+}
+
+static void heap_sift_up(timer_queue_t *p_tq, int idx, tq_node_t *p_node)
+{
+	int parent;
+	while (idx > 0) {
+		parent = (idx - 1) / HEAP_ARITY;
+		if (p_tq->heap[parent]->key <= p_node->key) {
+			break;
+		}
+		heap_place(p_tq, idx, p_tq->heap[parent]);
+		idx = parent;
+	}
+	heap_place(p_tq, idx, p_node);
+}
+
+static void heap_sift_down(timer_queue_t *p_tq, int idx, tq_node_t *p_node)
+{
+	int i, child, last, min;
+	while (1) {
+		child = idx * HEAP_ARITY + 1;
+		if (child >= p_tq->count) {
+			break;
+		}
+		min = child;
+		last = (child + HEAP_ARITY < p_tq->count) ? child + HEAP_ARITY : p_tq->count;
+		for (i = child + 1; i < last; i++) {
+			if (p_tq->heap[i]->key < p_tq->heap[min]->key) {
+				min = i;
+			}
+		}
+		if (p_node->key <= p_tq->heap[min]->key) {
+			break;
+		}
+		heap_place(p_tq, idx, p_tq->heap[min]);
+		idx = min;
+	}
+	heap_place(p_tq, idx, p_node);
+}
+
+static int tq_heap_init(timer_queue_t *p_tq, int capacity)
+{
+	if (capacity < HEAP_MIN_CAPACITY) {
+		capacity = HEAP_MIN_CAPACITY;
+	}
+	p_tq->heap = (tq_node_t **)calloc(sizeof(tq_node_t *), capacity);
+	if (NULL == p_tq->heap) {
+		printf("%s: calloc failed!\n", __func__);
+		return -1;
+	}
+	p_tq->capacity = capacity;
+	p_tq->count = 0;
+	return 0;
+}
+
+static void tq_heap_fini(timer_queue_t *p_tq)
+{
+	if (NULL != p_tq->heap) {
+		free(p_tq->heap);
+		p_tq->heap = NULL;
+	}
+	p_tq->capacity = 0;
+	p_tq->count = 0;
+}
+
+static int tq_heap_insert(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	//caller owned nodes are not bounded by bucket size, grow on demand.
+	if (p_tq->count == p_tq->capacity) {
+		tq_node_t **heap = (tq_node_t **)realloc(p_tq->heap, sizeof(tq_node_t *) * p_tq->capacity * 2);
+		if (NULL == heap) {
+			printf("%s: realloc failed!\n", __func__);
+			return -1;
+		}
+		p_tq->heap = heap;
+		p_tq->capacity *= 2;
+	}
+	heap_sift_up(p_tq, p_tq->count++, p_node);
+	return 0;
+}
+
+static void tq_heap_remove(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	int idx = p_node->idx;
+	tq_node_t *p_last = p_tq->heap[--p_tq->count];
+
+	p_node->idx = -1;
+	if (p_last == p_node) {
+		return;
+	}
+
+	//fill the hole with last node, which may need to go either way.
+	if (idx > 0 && p_last->key < p_tq->heap[(idx - 1) / HEAP_ARITY]->key) {
+		heap_sift_up(p_tq, idx, p_last);
+	} else {
+		heap_sift_down(p_tq, idx, p_last);
+	}
+}
+
+static tq_node_t* tq_heap_peek_min(timer_queue_t *p_tq)
+{
+	return (p_tq->count > 0) ? p_tq->heap[0] : NULL;
+}
+
+static tq_node_t* tq_heap_pop_expired(timer_queue_t *p_tq, int64_t now)
+{
+	tq_node_t *p_node = tq_heap_peek_min(p_tq);
+	if (NULL == p_node || p_node->key > now) {
+		return NULL;
+	}
+	tq_heap_remove(p_tq, p_node);
+	return p_node;
+}
+
+//subtree of a node with key >= limit holds no key < limit, skip it.
+static void heap_walk(timer_queue_t *p_tq, int idx, int64_t limit, tq_walk_func func, void *arg)
+{
+	int i, child;
+	if (p_tq->heap[idx]->key >= limit) {
+		return;
+	}
+	func(p_tq->heap[idx], arg);
+	child = idx * HEAP_ARITY + 1;
+	for (i = child; i < child + HEAP_ARITY && i < p_tq->count; i++) {
+		heap_walk(p_tq, i, limit, func, arg);
+	}
+}
+
+static void tq_heap_walk_before(timer_queue_t *p_tq, int64_t limit, tq_walk_func func, void *arg)
+{
+	if (p_tq->count > 0) {
+		heap_walk(p_tq, 0, limit, func, arg);
+	}
+}
+
+const timer_queue_ops_t g_tq_heap_ops = {
+	.name = "heap",
+	.init = tq_heap_init,
+	.fini = tq_heap_fini,
+	.insert = tq_heap_insert,
+	.remove = tq_heap_remove,
+	.peek_min = tq_heap_peek_min,
+	.pop_expired = tq_heap_pop_expired,
+	.walk_before = tq_heap_walk_before,
+};
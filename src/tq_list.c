@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timer_queue.h"
+
+//sorted list backend, list head is always the next timer to expire.
+
+//equal keys count as greater, so a new timer goes after those of same deadline without walking past them.
+static int compare_node_for_insert(list_head_t* ptr1, list_head_t* ptr2)
+{
+	tq_node_t* p_node1 = list_entry(ptr1, tq_node_t, entry);
+	tq_node_t* p_node2 = list_entry(ptr2, tq_node_t, entry);
+	return (p_node1->key >= p_node2->key) ? 1 : -1;
+}
+
+static int tq_list_init(timer_queue_t *p_tq, int capacity)
+{
+	list_init(&p_tq->list);
+	p_tq->count = 0;
+	return 0;
+}
+
+static void tq_list_fini(timer_queue_t *p_tq)
+{
+	list_init(&p_tq->list);
+	p_tq->count = 0;
+}
+
+static int tq_list_insert(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	//new timers mostly expire last, search from tail.
+	list_insert_reverse(&p_node->entry, &p_tq->list, compare_node_for_insert, 1);
+	p_node->idx = 0;
+	p_tq->count++;
+	return 0;
+}
+
+static void tq_list_remove(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	list_del(&p_node->entry);
+	p_node->idx = -1;
+	p_tq->count--;
+}
+
+static tq_node_t* tq_list_peek_min(timer_queue_t *p_tq)
+{
+	if (list_empty(&p_tq->list)) {
+		return NULL;
+	}
+	return list_entry(p_tq->list.next, tq_node_t, entry);
+}
+
+static tq_node_t* tq_list_pop_expired(timer_queue_t *p_tq, int64_t now)
+{
+	tq_node_t *p_node = tq_list_peek_min(p_tq);
+	if (NULL == p_node || p_node->key > now) {
+		return NULL;
+	}
+	tq_list_remove(p_tq, p_node);
+	return p_node;
+}
+
+static void tq_list_walk_before(timer_queue_t *p_tq, int64_t limit, tq_walk_func func, void *arg)
+{
+	tq_node_t *pos;
+	list_for_each_entry(pos, &p_tq->list, entry) {
+		if (pos->key >= limit) {
+			break;
+		}
+		func(pos, arg);
+	}
+}
+
+const timer_queue_ops_t g_tq_list_ops = {
+	.name = "list",
+	.init = tq_list_init,
+	.fini = tq_list_fini,
+	.insert = tq_list_insert,
+	.remove = tq_list_remove,
+	.peek_min = tq_list_peek_min,
+	.pop_expired = tq_list_pop_expired,
+	.walk_before = tq_list_walk_before,
+};
@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "simd.h"
+#include "timer_queue.h"
+
+//hashed timing wheel backend.
+//slot of a node is (key / tick) % WHEEL_SLOTS, a slot holds nodes of every round.
+//deadlines of a slot are kept in a contiguous array beside the node pointers, so expiry of a
+//slot is found 64 entries at once by the vector kernel instead of chasing list pointers.
+//
+//a slot array is split in two: [0, near) are entries due by tick near_end - 1, the round being
+//looked at, [near, count) are later rounds. a slot is synced to a tick when pop, peek or walk reach it,
+//which moves entries between the two once per round, so those only scan the round they look at.
+//
+//expired entries are popped from top of near entries down, removal moves the last near entry into the hole,
+//entries above the scan position are known not expired, so nothing moved in needs a rescan.
+
+#define WHEEL_SLOTS			1024	//must be power of 2.
+#define WHEEL_SLOT_MIN		16
+#define WHEEL_SCAN_BLOCK	64
+
+typedef struct st_wheel_slot {
+	int64_t*			keys;		//deadlines.
+	tq_node_t**			nodes;		//nodes, same position as keys.
+	int					count;
+	int					capacity;
+	int					near;		//entries before it are due by tick near_end - 1.
+	int					pad;		//padding bytes.
+	int64_t				near_end;	//tick bound of near entries, exclusive.
+} wheel_slot_t;
+
+typedef struct st_tq_wheel {
+	wheel_slot_t		slots[WHEEL_SLOTS];
+	int64_t				cur_tick;	//first tick not fully expired, INT64_MAX when empty.
+	int64_t				scan_tick;	//tick of cached scan, -1 when invalid.
+	int64_t				scan_now;	//time the cached scan was done against.
+	uint64_t			scan_mask;	//expired bits of block at scan_base not popped yet.
+	int					scan_base;	//start of scanned block.
+	int					scan_top;	//entries below are not scanned yet.
+} tq_wheel_t;
+
+static inline int64_t wheel_tick_of(timer_queue_t *p_tq, int64_t key)
+{
+	return key / p_tq->tick;
+}
+
+static inline wheel_slot_t* wheel_slot_of(tq_wheel_t *p_wheel, int64_t tick)
+{
+	return &p_wheel->slots[tick & (WHEEL_SLOTS - 1)];
+}
+
+static inline void wheel_move(wheel_slot_t *p_slot, int from, int to)
+{
+	if (from != to) {
+		p_slot->keys[to] = p_slot->keys[from];
+		p_slot->nodes[to] = p_slot->nodes[from];
+		p_slot->nodes[to]->idx = to;
+	}
+}
+
+static inline void wheel_swap(wheel_slot_t *p_slot, int i, int j)
+{
+	int64_t key = p_slot->keys[i];
+	tq_node_t *p_node = p_slot->nodes[i];
+
+	p_slot->keys[i] = p_slot->keys[j];
+	p_slot->nodes[i] = p_slot->nodes[j];
+	p_slot->nodes[i]->idx = i;
+	p_slot->keys[j] = key;
+	p_slot->nodes[j] = p_node;
+	p_node->idx = j;
+}
+
+static void wheel_remove_at(wheel_slot_t *p_slot, int idx)
+{
+	p_slot->nodes[idx]->idx = -1;
+	//a near hole is filled by the last near entry, the hole left there by the last entry.
+	if (idx < p_slot->near) {
+		wheel_move(p_slot, --p_slot->near, idx);
+		idx = p_slot->near;
+	}
+	wheel_move(p_slot, --p_slot->count, idx);
+}
+
+//@function: make near entries of slot exactly those due by tick.
+static void wheel_slot_sync(timer_queue_t *p_tq, wheel_slot_t *p_slot, int64_t tick)
+{
+	int i, base, n;
+	uint64_t mask;
+	int64_t limit = (tick + 1) * p_tq->tick;
+
+	if (p_slot->near_end == tick + 1) {
+		return;
+	}
+	if (p_slot->near_end < tick + 1) {
+		//entries before i are checked, a checked one not due is what a swap moves to i.
+		for (base = p_slot->near; base < p_slot->count; base += WHEEL_SCAN_BLOCK) {
+			n = (p_slot->count - base > WHEEL_SCAN_BLOCK) ? WHEEL_SCAN_BLOCK : p_slot->count - base;
+			for (mask = simd_expired_mask(p_slot->keys + base, n, limit - 1); 0 != mask; mask &= mask - 1) {
+				i = base + __builtin_ctzll(mask);
+				if (i != p_slot->near) {
+					wheel_swap(p_slot, i, p_slot->near);
+				}
+				p_slot->near++;
+			}
+		}
+	} else {
+		//clock went back below an earlier sync, rare.
+		for (i = p_slot->near - 1; i >= 0; i--) {
+			if (p_slot->keys[i] >= limit) {
+				wheel_swap(p_slot, i, --p_slot->near);
+			}
+		}
+	}
+	p_slot->near_end = tick + 1;
+}
+
+static int tq_wheel_init(timer_queue_t *p_tq, int capacity)
+{
+	if (p_tq->tick <= 0) {
+		printf("%s: Invalid tick!\n", __func__);
+		return -1;
+	}
+	p_tq->wheel = (tq_wheel_t *)calloc(sizeof(tq_wheel_t), 1);
+	if (NULL == p_tq->wheel) {
+		printf("%s: calloc failed!\n", __func__);
+		return -1;
+	}
+	p_tq->wheel->cur_tick = INT64_MAX;
+	p_tq->wheel->scan_tick = -1;
+	p_tq->count = 0;
+	return 0;
+}
+
+static void tq_wheel_fini(timer_queue_t *p_tq)
+{
+	int i;
+	if (NULL == p_tq->wheel) {
+		return;
+	}
+	for (i = 0; i < WHEEL_SLOTS; i++) {
+		free(p_tq->wheel->slots[i].keys);
+		free(p_tq->wheel->slots[i].nodes);
+	}
+	free(p_tq->wheel);
+	p_tq->wheel = NULL;
+	p_tq->count = 0;
+}
+
+static int tq_wheel_insert(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	tq_wheel_t *p_wheel = p_tq->wheel;
+	int64_t tick = wheel_tick_of(p_tq, p_node->key);
+	wheel_slot_t *p_slot = wheel_slot_of(p_wheel, tick);
+
+	if (p_slot->count == p_slot->capacity) {
+		int capacity = (p_slot->capacity > 0) ? p_slot->capacity * 2 : WHEEL_SLOT_MIN;
+		int64_t *keys = (int64_t *)realloc(p_slot->keys, sizeof(int64_t) * capacity);
+		if (NULL == keys) {
+			printf("%s: realloc failed!\n", __func__);
+			return -1;
+		}
+		p_slot->keys = keys;
+		tq_node_t **nodes = (tq_node_t **)realloc(p_slot->nodes, sizeof(tq_node_t *) * capacity);
+		if (NULL == nodes) {
+			printf("%s: realloc failed!\n", __func__);
+			return -1;
+		}
+		p_slot->nodes = nodes;
+		p_slot->capacity = capacity;
+	}
+
+	p_slot->keys[p_slot->count] = p_node->key;
+	p_slot->nodes[p_slot->count] = p_node;
+	p_node->idx = p_slot->count++;
+	p_tq->count++;
+	if (tick < p_slot->near_end) {
+		wheel_swap(p_slot, p_node->idx, p_slot->near++);
+	}
+
+	if (tick < p_wheel->cur_tick) {
+		p_wheel->cur_tick = tick;
+	}
+	if (p_slot == wheel_slot_of(p_wheel, p_wheel->scan_tick)) {
+		p_wheel->scan_tick = -1;
+	}
+	return 0;
+}
+
+static void tq_wheel_remove(timer_queue_t *p_tq, tq_node_t *p_node)
+{
+	tq_wheel_t *p_wheel = p_tq->wheel;
+	wheel_slot_t *p_slot = wheel_slot_of(p_wheel, wheel_tick_of(p_tq, p_node->key));
+
+	//entry moved into the hole may be an expired one in the pending scan block, rescan.
+	if (p_slot == wheel_slot_of(p_wheel, p_wheel->scan_tick)) {
+		p_wheel->scan_tick = -1;
+	}
+	wheel_remove_at(p_slot, p_node->idx);
+	if (0 == --p_tq->count) {
+		p_wheel->cur_tick = INT64_MAX;
+	}
+}
+
+//@return: entry with min key not after limit among first count entries of slot, NULL if none.
+static tq_node_t* wheel_slot_min(wheel_slot_t *p_slot, int count, int64_t limit)
+{
+	int base, bit;
+	uint64_t mask;
+	tq_node_t *p_min = NULL;
+
+	for (base = 0; base < count; base += WHEEL_SCAN_BLOCK) {
+		int n = (count - base > WHEEL_SCAN_BLOCK) ? WHEEL_SCAN_BLOCK : count - base;
+		for (mask = simd_expired_mask(p_slot->keys + base, n, limit); 0 != mask; mask &= mask - 1) {
+			bit = __builtin_ctzll(mask);
+			if (NULL == p_min || p_slot->keys[base + bit] < p_min->key) {
+				p_min = p_slot->nodes[base + bit];
+			}
+		}
+	}
+	return p_min;
+}
+
+static tq_node_t* tq_wheel_peek_min(timer_queue_t *p_tq)
+{
+	int n;
+	int64_t tick;
+	tq_node_t *p_min = NULL, *p_node;
+	wheel_slot_t *p_slot;
+	tq_wheel_t *p_wheel = p_tq->wheel;
+
+	if (0 == p_tq->count) {
+		return NULL;
+	}
+
+	//first slot holding an entry of its own round has the min.
+	for (n = 0, tick = p_wheel->cur_tick; n < WHEEL_SLOTS; n++, tick++) {
+		p_slot = wheel_slot_of(p_wheel, tick);
+		if (0 == p_slot->count) {
+			continue;
+		}
+		wheel_slot_sync(p_tq, p_slot, tick);
+		p_min = wheel_slot_min(p_slot, p_slot->near, INT64_MAX);
+		if (NULL != p_min) {
+			return p_min;
+		}
+	}
+
+	//all entries are more than a round ahead.
+	for (n = 0; n < WHEEL_SLOTS; n++) {
+		p_node = wheel_slot_min(&p_wheel->slots[n], p_wheel->slots[n].count, INT64_MAX);
+		if (NULL != p_node && (NULL == p_min || p_node->key < p_min->key)) {
+			p_min = p_node;
+		}
+	}
+	return p_min;
+}
+
+static tq_node_t* tq_wheel_pop_expired(timer_queue_t *p_tq, int64_t now)
+{
+	int bit, idx;
+	tq_node_t *p_node;
+	wheel_slot_t *p_slot;
+	tq_wheel_t *p_wheel = p_tq->wheel;
+	int64_t now_tick = wheel_tick_of(p_tq, now);
+
+	if (0 == p_tq->count) {
+		return NULL;
+	}
+
+	//lagging more than a round, one pass over every slot finds all expired entries.
+	if (p_wheel->cur_tick <= now_tick - WHEEL_SLOTS) {
+		p_wheel->cur_tick = now_tick - WHEEL_SLOTS + 1;
+		p_wheel->scan_tick = -1;
+	}
+
+	while (p_wheel->cur_tick <= now_tick) {
+		p_slot = wheel_slot_of(p_wheel, p_wheel->cur_tick);
+		if (p_wheel->scan_tick != p_wheel->cur_tick || p_wheel->scan_now != now) {
+			wheel_slot_sync(p_tq, p_slot, p_wheel->cur_tick);
+			p_wheel->scan_tick = p_wheel->cur_tick;
+			p_wheel->scan_now = now;
+			p_wheel->scan_top = p_slot->near;
+			p_wheel->scan_mask = 0;
+		}
+
+		while (0 != p_wheel->scan_mask || p_wheel->scan_top > 0) {
+			if (0 == p_wheel->scan_mask) {
+				p_wheel->scan_base = (p_wheel->scan_top > WHEEL_SCAN_BLOCK) ? p_wheel->scan_top - WHEEL_SCAN_BLOCK : 0;
+				p_wheel->scan_mask = simd_expired_mask(p_slot->keys + p_wheel->scan_base,
+													   p_wheel->scan_top - p_wheel->scan_base, now);
+				p_wheel->scan_top = p_wheel->scan_base;
+				continue;
+			}
+
+			bit = 63 - __builtin_clzll(p_wheel->scan_mask);
+			p_wheel->scan_mask &= ~(1ULL << bit);
+			idx = p_wheel->scan_base + bit;
+			p_node = p_slot->nodes[idx];
+			wheel_remove_at(p_slot, idx);
+			if (0 == --p_tq->count) {
+				p_wheel->cur_tick = INT64_MAX;
+				p_wheel->scan_tick = -1;
+			}
+			return p_node;
+		}
+
+		//slot done for this tick, stay on current tick, later timers may still land here.
+		if (p_wheel->cur_tick == now_tick) {
+			break;
+		}
+		p_wheel->cur_tick++;
+	}
+	return NULL;
+}
+
+static void tq_wheel_walk_before(timer_queue_t *p_tq, int64_t limit, tq_walk_func func, void *arg)
+{
+	int i, n, nslots, count, whole = 1;
+	uint64_t mask;
+	int64_t tick;
+	wheel_slot_t *p_slot;
+	tq_wheel_t *p_wheel = p_tq->wheel;
+
+	if (0 == p_tq->count || limit <= 0) {
+		return;
+	}
+
+	//keys below limit lie in slots of ticks up to the one of limit - 1, visit each slot at most once.
+	//within a round only near entries of each slot can be below limit, a longer window scans whole slots.
+	nslots = WHEEL_SLOTS;
+	if (wheel_tick_of(p_tq, limit - 1) - p_wheel->cur_tick < WHEEL_SLOTS) {
+		nslots = (int)(wheel_tick_of(p_tq, limit - 1) - p_wheel->cur_tick + 1);
+		whole = 0;
+	}
+	for (n = 0, tick = p_wheel->cur_tick; n < nslots; n++, tick++) {
+		p_slot = wheel_slot_of(p_wheel, tick);
+		if (0 == p_slot->count) {
+			continue;
+		}
+		count = p_slot->count;
+		if (!whole) {
+			wheel_slot_sync(p_tq, p_slot, tick);
+			count = p_slot->near;
+		}
+		for (i = 0; i < count; i += WHEEL_SCAN_BLOCK) {
+			int nkeys = (count - i > WHEEL_SCAN_BLOCK) ? WHEEL_SCAN_BLOCK : count - i;
+			for (mask = simd_expired_mask(p_slot->keys + i, nkeys, limit - 1); 0 != mask; mask &= mask - 1) {
+				func(p_slot->nodes[i + __builtin_ctzll(mask)], arg);
+			}
+		}
+	}
+}
+
+const timer_queue_ops_t g_tq_wheel_ops = {
+	.name = "wheel",
+	.init = tq_wheel_init,
+	.fini = tq_wheel_fini,
+	.insert = tq_wheel_insert,
+	.remove = tq_wheel_remove,
+	.peek_min = tq_wheel_peek_min,
+	.pop_expired = tq_wheel_pop_expired,
+	.walk_before = tq_wheel_walk_before,
+};
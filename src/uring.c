@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+int uring_init(uring_t *p_ring, unsigned entries)
+{
+	struct io_uring_params params;
+
+	memset(p_ring, 0, sizeof(uring_t));
+	memset(&params, 0, sizeof(params));
+	p_ring->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (p_ring->ring_fd < 0) {
+		printf("%s: io_uring_setup failed with error info: %s!\n", __func__, strerror(errno));
+		return -1;
+	}
+
+	p_ring->sq_entries = params.sq_entries;
+	p_ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	p_ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (p_ring->cq_len > p_ring->sq_len) {
+			p_ring->sq_len = p_ring->cq_len;
+		}
+		p_ring->cq_len = p_ring->sq_len;
+	}
+
+	p_ring->sq_ptr = mmap(NULL, p_ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+						  p_ring->ring_fd, IORING_OFF_SQ_RING);
+	if (MAP_FAILED == p_ring->sq_ptr) {
+		p_ring->sq_ptr = NULL;
+		goto cleanup;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		p_ring->cq_ptr = p_ring->sq_ptr;
+	} else {
+		p_ring->cq_ptr = mmap(NULL, p_ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+							  p_ring->ring_fd, IORING_OFF_CQ_RING);
+		if (MAP_FAILED == p_ring->cq_ptr) {
+			p_ring->cq_ptr = NULL;
+			goto cleanup;
+		}
+	}
+	p_ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	p_ring->sqes = (struct io_uring_sqe *)mmap(NULL, p_ring->sqes_len, PROT_READ | PROT_WRITE,
+											   MAP_SHARED | MAP_POPULATE, p_ring->ring_fd, IORING_OFF_SQES);
+	if (MAP_FAILED == p_ring->sqes) {
+		p_ring->sqes = NULL;
+		goto cleanup;
+	}
+
+	p_ring->sq_head = (unsigned *)((char *)p_ring->sq_ptr + params.sq_off.head);
+	p_ring->sq_tail = (unsigned *)((char *)p_ring->sq_ptr + params.sq_off.tail);
+	p_ring->sq_mask = (unsigned *)((char *)p_ring->sq_ptr + params.sq_off.ring_mask);
+	p_ring->sq_array = (unsigned *)((char *)p_ring->sq_ptr + params.sq_off.array);
+	p_ring->cq_head = (unsigned *)((char *)p_ring->cq_ptr + params.cq_off.head);
+	p_ring->cq_tail = (unsigned *)((char *)p_ring->cq_ptr + params.cq_off.tail);
+	p_ring->cq_mask = (unsigned *)((char *)p_ring->cq_ptr + params.cq_off.ring_mask);
+	p_ring->cqes = (struct io_uring_cqe *)((char *)p_ring->cq_ptr + params.cq_off.cqes);
+	p_ring->sqe_tail = *p_ring->sq_tail;
+	return 0;
+
+cleanup:
+	printf("%s: mmap failed with error info: %s!\n", __func__, strerror(errno));
+	uring_exit(p_ring);
+	return -1;
+}
+
+void uring_exit(uring_t *p_ring)
+{
+	if (NULL != p_ring->sqes) {
+		munmap(p_ring->sqes, p_ring->sqes_len);
+		p_ring->sqes = NULL;
+	}
+	if (NULL != p_ring->cq_ptr && p_ring->cq_ptr != p_ring->sq_ptr) {
+		munmap(p_ring->cq_ptr, p_ring->cq_len);
+	}
+	p_ring->cq_ptr = NULL;
+	if (NULL != p_ring->sq_ptr) {
+		munmap(p_ring->sq_ptr, p_ring->sq_len);
+		p_ring->sq_ptr = NULL;
+	}
+	if (p_ring->ring_fd > 0) {
+		close(p_ring->ring_fd);
+		p_ring->ring_fd = 0;
+	}
+}
+
+struct io_uring_sqe* uring_get_sqe(uring_t *p_ring)
+{
+	unsigned head = __atomic_load_n(p_ring->sq_head, __ATOMIC_ACQUIRE);
+	unsigned tail = p_ring->sqe_tail;
+	struct io_uring_sqe *p_sqe;
+
+	if (tail - head >= p_ring->sq_entries) {
+		return NULL;
+	}
+
+	//sq array maps ring slot to the sqe of same index.
+	p_sqe = &p_ring->sqes[tail & *p_ring->sq_mask];
+	memset(p_sqe, 0, sizeof(struct io_uring_sqe));
+	p_ring->sq_array[tail & *p_ring->sq_mask] = tail & *p_ring->sq_mask;
+	p_ring->sqe_tail = tail + 1;
+	p_ring->to_submit++;
+	return p_sqe;
+}
+
+int uring_submit_and_wait(uring_t *p_ring, unsigned wait_nr)
+{
+	int nret;
+	unsigned flags = (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0;
+
+	__atomic_store_n(p_ring->sq_tail, p_ring->sqe_tail, __ATOMIC_RELEASE);
+	nret = syscall(__NR_io_uring_enter, p_ring->ring_fd, p_ring->to_submit, wait_nr, flags, NULL, 0);
+	if (nret < 0) {
+		return -1;
+	}
+	p_ring->to_submit -= nret;
+	return nret;
+}
+
+struct io_uring_cqe* uring_peek_cqe(uring_t *p_ring)
+{
+	unsigned head = *p_ring->cq_head;
+	if (head == __atomic_load_n(p_ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	return &p_ring->cqes[head & *p_ring->cq_mask];
+}
+
+void uring_cqe_seen(uring_t *p_ring)
+{
+	__atomic_store_n(p_ring->cq_head, *p_ring->cq_head + 1, __ATOMIC_RELEASE);
+}
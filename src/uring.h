@@ -0,0 +1,55 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+//minimal io_uring wrapper on raw syscalls, only what timer bucket work thread needs.
+
+typedef struct st_uring {
+	int					ring_fd;		//fd from io_uring_setup.
+	unsigned			sq_entries;		//sq size.
+	unsigned			to_submit;		//sqes queued since last submit.
+	unsigned			sqe_tail;		//tail of filled sqes, published to kernel on submit.
+
+	unsigned*			sq_head;
+	unsigned*			sq_tail;
+	unsigned*			sq_mask;
+	unsigned*			sq_array;
+	struct io_uring_sqe*	sqes;
+
+	unsigned*			cq_head;
+	unsigned*			cq_tail;
+	unsigned*			cq_mask;
+	struct io_uring_cqe*	cqes;
+
+	void*				sq_ptr;			//mmap of sq ring.
+	void*				cq_ptr;			//mmap of cq ring, same as sq_ptr with IORING_FEAT_SINGLE_MMAP.
+	size_t				sq_len;
+	size_t				cq_len;
+	size_t				sqes_len;
+} uring_t;
+
+//@function: setup ring.
+//@return: -1 on error (e.g. io_uring unavailable), 0 on success.
+int uring_init(uring_t *p_ring, unsigned entries);
+
+void uring_exit(uring_t *p_ring);
+
+//@function: get a zeroed sqe, queued on next submit.
+//sq tail is published by uring_submit_and_wait once sqes are filled, kernel never sees a half made one.
+//@return: NULL if sq is full.
+struct io_uring_sqe* uring_get_sqe(uring_t *p_ring);
+
+//@function: submit queued sqes, wait for at least wait_nr completions.
+//@return: -1 on error, number of sqes submitted on success.
+int uring_submit_and_wait(uring_t *p_ring, unsigned wait_nr);
+
+//@function: get next completion without syscall.
+//@return: NULL if cq is empty.
+struct io_uring_cqe* uring_peek_cqe(uring_t *p_ring);
+
+//@function: release the completion got from uring_peek_cqe.
+void uring_cqe_seen(uring_t *p_ring);
+
+#endif //URING_H
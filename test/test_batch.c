@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "ltimer.h"
+
+#define BUCKET_SIZE		8
+#define BUCKET_CPUID	0
+#define NFULL			3000	//adds staged one by one while work thread is blocked, overflow the pipe.
+
+static volatile int g_fired[4];
+
+static void count_timeout(void *data)
+{
+	(*(volatile int *)data)++;
+}
+
+static void block_timeout(void *data)
+{
+	usleep(*(int *)data);
+}
+
+static int check(const char *what, int got, int expect)
+{
+	printf("%-28s got %d, expect %d\n", what, got, expect);
+	return (got == expect) ? 0 : 1;
+}
+
+static int compare_id(const void *a, const void *b)
+{
+	TimerID_t x = *(const TimerID_t *)a, y = *(const TimerID_t *)b;
+	return (x > y) - (x < y);
+}
+
+//flush finding the pipe full waits for work thread, every add keeps its own slot and fires.
+static int test_full_pipe(void)
+{
+	int i, nfail = 0, ndup = 0, block = 200000;
+	static TimerID_t ids[NFULL];
+	volatile int fired = 0;
+	struct timespec tick = {0, 1000000};
+	struct timespec t1 = {0, 1000000};
+	struct timespec t500 = {0, 500000000};	//no slot fires and comes back while adding.
+	TimerBucketID_t bktid = create_timer_bucket("fullbucket", NFULL + 1, BUCKET_CPUID, tick);
+	if (-1 == bktid) {
+		return 1;
+	}
+
+	add_timer(bktid, t1, block_timeout, (void *)&block, 0);
+	usleep(20000);
+	ltimer_batch_start(1);
+	for (i = 0; i < NFULL; i++) {
+		ids[i] = add_timer(bktid, t500, count_timeout, (void *)&fired, 0);
+	}
+	nfail += check("full pipe flush", ltimer_batch_stop(), 0);
+
+	qsort(ids, NFULL, sizeof(ids[0]), compare_id);
+	for (i = 1; i < NFULL; i++) {
+		ndup += (ids[i] == ids[i - 1]);
+	}
+	nfail += check("full pipe failed adds", -1 == ids[0], 0);
+	nfail += check("full pipe shared slots", ndup, 0);
+	for (i = 0; i < 2000 && fired < NFULL; i++) {
+		usleep(1000);
+	}
+	nfail += check("full pipe fired", fired, NFULL);
+
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+//a staged del, then its slot fired cancelled and given to a new add, later mods go to the new add.
+static int test_reused_slot(void)
+{
+	int nfail = 0;
+	volatile int fired = 0, stale = 0;
+	struct timespec tick = {0, 1000000};
+	struct timespec t1 = {0, 1000000};
+	struct timespec t5 = {0, 5000000};
+	struct timespec hour = {3600, 0};
+	TimerBucketID_t bktid = create_timer_bucket("reusebucket", 1, BUCKET_CPUID, tick);
+	if (-1 == bktid) {
+		return 1;
+	}
+
+	ltimer_batch_start(64);
+	TimerID_t old = add_timer(bktid, t1, count_timeout, (void *)&stale, 0);
+	ltimer_flush();
+	del_timer(old);
+	usleep(20000);
+
+	TimerID_t id = add_timer(bktid, hour, count_timeout, (void *)&fired, 0);
+	nfail += check("slot reused", id == old, 1);
+	mod_timer(id, t5, NULL, NULL);
+	ltimer_flush();
+	usleep(50000);
+	nfail += check("mod of reused slot fired", fired, 1);
+	nfail += check("deleted fired", stale, 0);
+
+	ltimer_batch_stop();
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+int main()
+{
+	int i, nfail = 0, nadd = 0;
+	struct timespec tick = {0, 1000000};
+	TimerBucketID_t bktid = create_timer_bucket("batchbucket", BUCKET_SIZE, BUCKET_CPUID, tick);
+	if (-1 == bktid || 0 != ltimer_batch_start(64)) {
+		exit(EXIT_FAILURE);
+	}
+
+	//short lived timers cancel out inside batch, pool slots come back at once.
+	struct timespec t1 = {0, 10000000};
+	for (i = 0; i < 1000; i++) {
+		TimerID_t id = add_timer(bktid, t1, count_timeout, (void *)&g_fired[0], 0);
+		if (-1 != id) {
+			nadd++;
+			del_timer(id);
+		}
+	}
+	nfail += check("coalesced adds", nadd, 1000);
+
+	//staged add is not posted before flush.
+	struct timespec t2 = {0, 1000000};
+	add_timer(bktid, t2, count_timeout, (void *)&g_fired[1], 0);
+	usleep(20000);
+	nfail += check("fired before flush", g_fired[1], 0);
+
+	//mods fold into staged add: first timeout 5 ms, last func and data.
+	struct timespec hour = {3600, 0};
+	struct timespec t3 = {0, 5000000};
+	struct timespec unset = {0, 0};
+	TimerID_t id = add_timer(bktid, hour, count_timeout, (void *)&g_fired[3], 0);
+	mod_timer(id, hour, NULL, NULL);
+	mod_timer(id, t3, NULL, NULL);
+	mod_timer(id, unset, NULL, (void *)&g_fired[2]);
+
+	//cycle timer, stopped by del_timer_sync.
+	TimerID_t cycle = add_timer(bktid, t3, count_timeout, (void *)&g_fired[3], 1);
+	ltimer_flush();
+	usleep(50000);
+	del_timer_sync(cycle);
+	int ncycle = g_fired[3];
+	usleep(20000);
+
+	nfail += check("fired after flush", g_fired[1], 1);
+	nfail += check("folded mods fired", g_fired[2], 1);
+	nfail += check("cycle fired after del", g_fired[3] - ncycle, 0);
+	nfail += check("cancelled fired", g_fired[0], 0);
+
+	ltimer_batch_stop();
+	destroy_timer_bucket(bktid);
+
+	nfail += test_full_pipe();
+	nfail += test_reused_slot();
+
+	printf("test_batch %s!\n", nfail ? "failed" : "passed");
+	return nfail ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "ltimer.h"
+
+#define BUCKET_SIZE		8
+#define BUCKET_CPUID	0
+
+static volatile int g_fired;
+
+static void count_timeout(void *data)
+{
+	(*(volatile int *)data)++;
+}
+
+static int check(const char *what, int got, int expect)
+{
+	printf("%-28s got %d, expect %d\n", what, got, expect);
+	return (got == expect) ? 0 : 1;
+}
+
+static int64_t until_ns(TimerBucketID_t bktid, struct timespec ts)
+{
+	struct timespec now;
+	bucket_curtime(bktid, &now);
+	return (int64_t)(ts.tv_sec - now.tv_sec) * 1000000000 + ts.tv_nsec - now.tv_nsec;
+}
+
+static void on_alarm(int sig)
+{
+	printf("test_cancel hung!\n");
+	_exit(EXIT_FAILURE);
+}
+
+int main()
+{
+	int i, nfail = 0;
+	struct timespec tick = {0, 1000000};
+	struct timespec t1 = {0, 5000000};
+	struct timespec hour = {3600, 0};
+	ltimer_node_t node;
+
+	//a hang is a failure, not a stuck test run.
+	signal(SIGALRM, on_alarm);
+	alarm(10);
+
+	TimerBucketID_t bktid = create_timer_bucket("cancelbucket", BUCKET_SIZE, BUCKET_CPUID, tick);
+	if (-1 == bktid) {
+		exit(EXIT_FAILURE);
+	}
+
+	//sync delete of a node timer which already fired.
+	TimerID_t id = add_timer_node(bktid, &node, t1, count_timeout, (void *)&g_fired);
+	for (i = 0; i < 1000 && 0 == g_fired; i++) {
+		usleep(1000);
+	}
+	nfail += check("node fired", g_fired, 1);
+	nfail += check("sync delete of fired node", del_timer_sync(id), 0);
+
+	//sync delete of a node timer still pending.
+	id = add_timer_node(bktid, &node, hour, count_timeout, (void *)&g_fired);
+	nfail += check("sync delete of pending node", del_timer_sync(id), 0);
+
+	//sync delete of a pool timer which already fired.
+	id = add_timer(bktid, t1, count_timeout, (void *)&g_fired, 0);
+	for (i = 0; i < 1000 && 1 == g_fired; i++) {
+		usleep(1000);
+	}
+	nfail += check("pool timer fired", g_fired, 2);
+	nfail += check("sync delete of fired timer", del_timer_sync(id), 0);
+
+	//first query of summary doesn't wait for work thread.
+	struct timespec next;
+	struct timespec t600 = {0, 600000000};
+	struct timespec t900 = {0, 900000000};
+	errno = 0;
+	nfail += check("summary not ready", bucket_next_expiry(bktid, &next), -1);
+	nfail += check("not ready errno", errno, EAGAIN);
+
+	//cancelled head still linked, staged unlink hint isn't posted yet.
+	id = add_timer(bktid, t600, count_timeout, (void *)&g_fired, 0);
+	add_timer(bktid, t900, count_timeout, (void *)&g_fired, 0);
+	for (i = 0; i < 1000 && !(1 == bucket_next_expiry(bktid, &next) && until_ns(bktid, next) < 700000000); i++) {
+		usleep(1000);
+	}
+	ltimer_batch_start(64);
+	del_timer(id);
+	usleep(20000);
+	nfail += check("next expiry found", bucket_next_expiry(bktid, &next), 1);
+	nfail += check("cancelled head skipped", until_ns(bktid, next) > 700000000, 1);
+	ltimer_batch_stop();
+
+	destroy_timer_bucket(bktid);
+
+	printf("test_cancel %s!\n", nfail ? "failed" : "passed");
+	return nfail ? EXIT_FAILURE : 0;
+}
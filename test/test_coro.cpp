@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+
+#include "ltimer_coro.hpp"
+
+#define BUCKET_SIZE		3
+#define BUCKET_CPUID	0
+
+using namespace std::chrono_literals;
+
+//fire and forget coroutine, frame is kept until destroyed by caller.
+struct task {
+	struct promise_type {
+		task get_return_object() { return task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { abort(); }
+	};
+	std::coroutine_handle<promise_type> handle;
+};
+
+//executor counting the resumptions it's given.
+struct counting_executor {
+	std::atomic<int> *posted;
+	void post(std::coroutine_handle<> h) const { posted->fetch_add(1); h.resume(); }
+};
+
+//op which only completes when cancelled.
+struct never_op {
+	std::coroutine_handle<> waiter;
+	bool cancelled = false;
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) { waiter = h; }
+	bool await_resume() const noexcept { return cancelled; }
+	void cancel() { cancelled = true; waiter.resume(); }
+};
+
+//op slow to suspend, deadline passes before it's ready to be cancelled.
+struct slow_op {
+	std::coroutine_handle<> waiter;
+	std::atomic<bool> suspended{false};
+	bool cancelled = false;
+	bool cancelled_early = false;
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> h) { waiter = h; usleep(30000); suspended = true; }
+	bool await_resume() const noexcept { return cancelled; }
+	void cancel() { cancelled_early = !suspended; cancelled = true; waiter.resume(); }
+};
+
+static std::atomic<int> g_step{0};
+static std::atomic<int> g_posted{0};
+
+static task sleeper(TimerBucketID_t bktid)
+{
+	co_await ltimer::sleep_for(bktid, 10ms);
+	g_step++;
+	co_await ltimer::sleep_for(bktid, 10ms, counting_executor{&g_posted});
+	g_step++;
+	never_op op;
+	bool cancelled = co_await ltimer::with_deadline(bktid, op, 20ms);
+	if (cancelled) {
+		g_step++;
+	}
+}
+
+static task deadline_checker(TimerBucketID_t bktid)
+{
+	slow_op op;
+	bool cancelled = co_await ltimer::with_deadline(bktid, op, 1ms);
+	if (cancelled && !op.cancelled_early) {
+		g_step++;
+	}
+	never_op idle;
+	try {
+		co_await ltimer::with_deadline((TimerBucketID_t)0, idle, 1ms);
+	} catch (const std::runtime_error&) {
+		g_step++;
+	}
+}
+
+static task long_sleeper(TimerBucketID_t bktid)
+{
+	co_await ltimer::sleep_for(bktid, 1h);
+	abort();
+}
+
+int main()
+{
+	struct timespec tick = {0, 1000000};
+	TimerBucketID_t bktid = create_timer_bucket("corobucket", BUCKET_SIZE, BUCKET_CPUID, tick);
+	if (-1 == bktid) {
+		exit(EXIT_FAILURE);
+	}
+
+	task t1 = sleeper(bktid);
+	task t2 = long_sleeper(bktid);
+	task t3 = deadline_checker(bktid);
+
+	int waited = 0;
+	while (g_step < 5 && waited++ < 1000) {
+		usleep(1000);
+	}
+
+	//destroy a frame suspended on timer, its timer must be cancelled.
+	t2.handle.destroy();
+
+	printf("steps = %d, posted = %d\n", g_step.load(), g_posted.load());
+	if (g_step != 5 || g_posted != 1 || !t1.handle.done() || !t3.handle.done()) {
+		printf("test_coro failed!\n");
+		return EXIT_FAILURE;
+	}
+	t1.handle.destroy();
+	t3.handle.destroy();
+	destroy_timer_bucket(bktid);
+
+	printf("test_coro passed!\n");
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ltimer.h"
+
+#define BUCKET_CPUID	0
+
+static volatile int g_reconf_fired;
+
+static void count_timeout(void *data)
+{
+	(*(volatile int *)data)++;
+}
+
+static int check(const char *what, int got, int expect)
+{
+	printf("%-28s got %d, expect %d\n", what, got, expect);
+	return (got == expect) ? 0 : 1;
+}
+
+static int64_t elapsed_ms(struct timespec *p_start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - p_start->tv_sec) * 1000 + (now.tv_nsec - p_start->tv_nsec) / 1000000;
+}
+
+//grow a full pool and shorten a long resolution in place, then destroy without waiting for a tick.
+static int test_resize(const char *what, int flags)
+{
+	int i, nadd = 0, nfail = 0;
+	struct timespec start;
+	struct timespec second = {1, 0};
+	struct timespec tick = {0, 1000000};
+	struct timespec t1 = {0, 20000000};
+	struct timespec unset = {0, 0};
+	struct timespec ten = {10, 0};
+
+	printf("---- reconfigure %s ----\n", what);
+	g_reconf_fired = 0;
+	TimerBucketID_t bktid = create_timer_bucket_ex("reconfbucket", 2, BUCKET_CPUID, second, flags);
+	if (-1 == bktid) {
+		return 1;
+	}
+	for (i = 0; i < 2; i++) {
+		nadd += (-1 != add_timer(bktid, t1, count_timeout, (void *)&g_reconf_fired, 0));
+	}
+	nfail += check("add to full pool", (int)add_timer(bktid, t1, count_timeout, (void *)&g_reconf_fired, 0), -1);
+	nfail += check("reconfigure", reconfigure_timer_bucket(bktid, 16, BUCKET_CPUID, tick), 0);
+	for (i = 0; i < 14; i++) {
+		nadd += (-1 != add_timer(bktid, t1, count_timeout, (void *)&g_reconf_fired, 0));
+	}
+	nfail += check("adds to grown pool", nadd, 16);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (g_reconf_fired < 16 && elapsed_ms(&start) < 500) {
+		usleep(1000);
+	}
+	nfail += check("fired at new resolution", g_reconf_fired, 16);
+
+	nfail += check("pool can't shrink", reconfigure_timer_bucket(bktid, 8, -1, unset), -1);
+	reconfigure_timer_bucket(bktid, 0, -1, ten);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	destroy_timer_bucket(bktid);
+	nfail += check("destroy is prompt", elapsed_ms(&start) < 1000, 1);
+	return nfail;
+}
+
+//expiry summary slots follow resolution of a reconfigured bucket.
+static int test_summary_width(void)
+{
+	int nfail = 0;
+	struct timespec coarse = {0, 20000000};
+	struct timespec fine = {0, 5000000};
+	struct timespec t1 = {0, 30000000};
+	struct timespec window = {0, 25000000};
+
+	printf("---- reconfigure summary ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("reconfbucket", 8, BUCKET_CPUID, coarse, LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+	add_timer(bktid, t1, count_timeout, (void *)&g_reconf_fired, 0);
+	nfail += check("window of 20 ms slots", (int)bucket_count_expiring(bktid, window), 1);
+	nfail += check("reconfigure", reconfigure_timer_bucket(bktid, 0, -1, fine), 0);
+	nfail += check("window of 5 ms slots", (int)bucket_count_expiring(bktid, window), 0);
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+int main()
+{
+	int nfail = 0;
+
+	nfail += test_resize("epoll", 0);
+	nfail += test_resize("io_uring", LTIMER_BKT_F_IOURING);
+	nfail += test_summary_width();
+
+	printf("test_reconf %s!\n", nfail ? "failed" : "passed");
+	return nfail ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ltimer.h"
+
+#define BUCKET_SIZE		4096
+#define BUCKET_CPUID	0
+#define NPRODUCERS		4
+#define NTIMERS			200		//timers added per producer.
+#define TRACE_PATH		"test_record.trace"
+#define REPLAY_PATH		"../tools/ltimer-replay"	//built by top level make.
+
+static TimerBucketID_t g_bktid;
+static volatile int g_fired;
+
+static void count_timeout(void *data)
+{
+	__sync_add_and_fetch((volatile int *)data, 1);
+}
+
+static int check(const char *what, long got, long expect)
+{
+	printf("%-28s got %ld, expect %ld\n", what, got, expect);
+	return (got == expect) ? 0 : 1;
+}
+
+//every 4th timer is deleted long before its deadline, every 4th one after that is modded to fire soon.
+static void* producer(void *arg)
+{
+	int i;
+	long id = (long)arg;
+	struct timespec hour = {3600, 0};
+
+	for (i = 0; i < NTIMERS; i++) {
+		struct timespec tm = {0, (1 + (id * NTIMERS + i) % 50) * 1000000};
+		if (0 == i % 4) {
+			del_timer(add_timer(g_bktid, hour, count_timeout, (void *)&g_fired, 0));
+		} else if (1 == i % 4) {
+			TimerID_t timer = add_timer(g_bktid, hour, count_timeout, (void *)&g_fired, 0);
+			mod_timer(timer, tm, NULL, NULL);
+		} else {
+			add_timer(g_bktid, tm, count_timeout, (void *)&g_fired, 0);
+		}
+		if (0 == i % 16) {
+			usleep(1000);
+		}
+	}
+	return NULL;
+}
+
+//@return: expires recorded and replayed as printed by ltimer-replay, -1 on error.
+static int replay(const char *backend, long *p_recorded, long *p_replayed)
+{
+	char line[256];
+	int found = -1;
+	snprintf(line, sizeof(line), "%s -b %s %s", REPLAY_PATH, backend, TRACE_PATH);
+	FILE *fp = popen(line, "r");
+	if (NULL == fp) {
+		return -1;
+	}
+	while (NULL != fgets(line, sizeof(line), fp)) {
+		if (2 == sscanf(line, "expires: recorded %ld, replayed %ld", p_recorded, p_replayed)) {
+			found = 0;
+		}
+	}
+	return (0 == pclose(fp)) ? found : -1;
+}
+
+int main()
+{
+	long i, recorded = 0, replayed = 0;
+	int nfail = 0, expect = NPRODUCERS * NTIMERS / 4 * 3;
+	pthread_t threads[NPRODUCERS];
+	struct timespec tick = {0, 1000000};
+	struct timespec hour = {3600, 0};
+	const char *backends[] = {"list", "heap", "wheel"};
+
+	g_bktid = create_timer_bucket("recordbucket", BUCKET_SIZE, BUCKET_CPUID, tick);
+	if (-1 == g_bktid || 0 != bucket_record_start(g_bktid, TRACE_PATH)) {
+		exit(EXIT_FAILURE);
+	}
+
+	//ops are recorded on producer threads while work thread moves bucket clock.
+	for (i = 0; i < NPRODUCERS; i++) {
+		pthread_create(&threads[i], NULL, producer, (void *)i);
+	}
+	for (i = 0; i < NPRODUCERS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	for (i = 0; i < 2000 && g_fired < expect; i++) {
+		usleep(1000);
+	}
+	nfail += check("fired live", g_fired, expect);
+
+	//trailing ops stretch replay well past last expiry.
+	usleep(20000);
+	del_timer(add_timer(g_bktid, hour, count_timeout, (void *)&g_fired, 0));
+	usleep(5000);
+	nfail += check("records dropped", bucket_record_stop(g_bktid), 0);
+	destroy_timer_bucket(g_bktid);
+
+	for (i = 0; i < (long)(sizeof(backends) / sizeof(backends[0])); i++) {
+		printf("---- replay %s ----\n", backends[i]);
+		if (0 != replay(backends[i], &recorded, &replayed)) {
+			printf("run %s failed!\n", REPLAY_PATH);
+			nfail++;
+			continue;
+		}
+		nfail += check("expires recorded", recorded, expect);
+		nfail += check("expires replayed", replayed, recorded);
+	}
+	unlink(TRACE_PATH);
+
+	printf("test_record %s!\n", nfail ? "failed" : "passed");
+	return nfail ? EXIT_FAILURE : 0;
+}
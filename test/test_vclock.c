@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+
+#include "ltimer.h"
+
+#define BUCKET_SIZE		200000
+#define BUCKET_CPUID	0
+
+static int g_fired[4];
+static TimerID_t g_self;
+
+static void count_timeout(void *data)
+{
+	(*(int *)data)++;
+}
+
+static void del_self_timeout(void *data)
+{
+	(*(int *)data)++;
+	del_timer(g_self);
+}
+
+static int g_lo_fired, g_lo_before_hi = -1;
+
+static void lo_timeout(void *data)
+{
+	g_lo_fired++;
+}
+
+static void hi_timeout(void *data)
+{
+	g_lo_before_hi = g_lo_fired;
+}
+
+static int check(const char *what, int got, int expect)
+{
+	printf("%-28s got %d, expect %d\n", what, got, expect);
+	return (got == expect) ? 0 : 1;
+}
+
+static int check_str(const char *what, const char *got, const char *expect)
+{
+	printf("%-28s got \"%s\", expect \"%s\"\n", what, got, expect);
+	return (0 == strcmp(got, expect)) ? 0 : 1;
+}
+
+//@param shuffle: add mass timers in random deadline order.
+static int run_test(const char *backend, int flags, int shuffle)
+{
+	int i, nfail = 0;
+	struct timespec tick = {0, 1000000};
+
+	printf("---- %s backend ----\n", backend);
+	memset(g_fired, 0, sizeof(g_fired));
+	TimerBucketID_t bktid = create_timer_bucket_ex("vbucket", BUCKET_SIZE, BUCKET_CPUID, tick,
+												   flags | LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+
+	struct timespec t1 = {0, 10000000};
+	struct timespec t2 = {0, 15000000};
+	add_timer(bktid, t1, count_timeout, &g_fired[0], 0);
+	TimerID_t cycle = add_timer(bktid, t2, count_timeout, &g_fired[1], 1);
+
+	//100 ms in 1 ms steps: once timer fires at 10ms, cycle timer at 15, 30, ..., 90.
+	struct timespec step = {0, 1000000};
+	for (i = 0; i < 100; i++) {
+		bucket_advance(bktid, step);
+	}
+	nfail += check("once timer", g_fired[0], 1);
+	nfail += check("cycle timer", g_fired[1], 6);
+
+	//one large step fires the same as small steps: 1 s more, cycle timer fires at 105, 120, ..., 1095.
+	struct timespec second = {1, 0};
+	nfail += check("large step fired", bucket_advance(bktid, second), 67);
+	nfail += check("cycle timer", g_fired[1], 73);
+
+	struct timespec now;
+	bucket_curtime(bktid, &now);
+	nfail += check("virtual clock ms", (int)(now.tv_sec * 1000 + now.tv_nsec / 1000000), 1100);
+
+	//virtual clock starts at epoch, strings are rendered on advance.
+	char str[64];
+	curtime_fmt(bktid, LTIMER_FMT_ISO_MS, str, sizeof(str));
+	nfail += check_str("iso ms", str, "1970-01-01T00:00:01.100Z");
+	curtime_fmt(bktid, LTIMER_FMT_ISO_US, str, sizeof(str));
+	nfail += check_str("iso us", str, "1970-01-01T00:00:01.100000Z");
+	curtime_fmt(bktid, LTIMER_FMT_HTTP, str, sizeof(str));
+	nfail += check_str("http date", str, "Thu, 01 Jan 1970 00:00:01 GMT");
+	nfail += check("truncated length", curtime_fmt(bktid, LTIMER_FMT_ISO_MS, str, 11), 10);
+	nfail += check_str("truncated", str, "1970-01-01");
+	del_timer(cycle);
+
+	//deleted timer never fires, cycle timer deleted inside its own callback fires once.
+	struct timespec t3 = {0, 5000000};
+	TimerID_t once = add_timer(bktid, t3, count_timeout, &g_fired[3], 0);
+	del_timer(once);
+	g_self = add_timer(bktid, t3, del_self_timeout, &g_fired[3], 1);
+	bucket_advance(bktid, second);
+	nfail += check("cancelled timers fired", g_fired[3], 1);
+
+	//high priority timer due in the same tick as bulk expiry fires first.
+	g_lo_fired = 0;
+	for (i = 0; i < 200; i++) {
+		add_timer(bktid, t3, lo_timeout, &g_lo_fired, 0);
+	}
+	add_timer(bktid, t3, hi_timeout, &g_lo_before_hi, LTIMER_F_HIGHPRIO);
+	nfail += check("bulk expiry fired", bucket_advance(bktid, t3), 201);
+	nfail += check("fired before high priority", g_lo_before_hi, 0);
+
+	//mass timers over an hour of virtual time, added without any pipe traffic.
+	clock_t begin = clock();
+	for (i = 0; i < 100000; i++) {
+		int n = shuffle ? (int)(((unsigned)i * 2654435761u) % 100000) : i;
+		struct timespec tm = {n / 28, (n % 28) * 1000000 + 1};
+		if (-1 == add_timer(bktid, tm, count_timeout, &g_fired[2], 0)) {
+			break;
+		}
+	}
+
+	//28 timers a second, first one 1 ns from now.
+	struct timespec next;
+	bucket_curtime(bktid, &now);
+	nfail += check("next expiry found", bucket_next_expiry(bktid, &next), 1);
+	nfail += check("next expiry ns", (int)((next.tv_sec - now.tv_sec) * 1000000000 + next.tv_nsec - now.tv_nsec), 1);
+	nfail += check("expiring in a second", (int)bucket_count_expiring(bktid, second), 28);
+
+	struct timespec hour = {3601, 0};
+	bucket_advance(bktid, hour);
+	nfail += check("next expiry found", bucket_next_expiry(bktid, &next), 0);
+	nfail += check("mass once timers", g_fired[2], 100000);
+	printf("mass timers simulated in %.3f s\n", (double)(clock() - begin) / CLOCKS_PER_SEC);
+
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+//cycle timers added together fire spread over their period instead of in one tick.
+static int test_spread(void)
+{
+	int i, nfired, nmax = 0, ntotal = 0, nfail = 0;
+	struct timespec tick = {0, 1000000};
+	struct timespec period = {0, 100000000};
+
+	printf("---- spread ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vspread", 1000, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+	for (i = 0; i < 1000; i++) {
+		add_timer(bktid, period, count_timeout, &g_fired[0], 1 | LTIMER_F_SPREAD);
+	}
+	//1000 timers over 100 ticks, about 10 per tick.
+	for (i = 0; i < 300; i++) {
+		nfired = bucket_advance(bktid, tick);
+		nmax = (nfired > nmax) ? nfired : nmax;
+		ntotal += nfired;
+	}
+	nfail += check("spread fires per tick ok", nmax <= 40, 1);
+	nfail += check("spread timers fired twice", ntotal >= 2000 && ntotal <= 3000, 1);
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+//expiries go to completion queue, ring full ones are retried on next tick.
+static int test_cq(void)
+{
+	int i, n, nfail = 0;
+	long sum = 0;
+	ltimer_cqe_t cqes[8];
+	struct timespec tick = {0, 1000000};
+
+	printf("---- completion queue ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vcq", 16, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	TimerCQID_t cq = create_timer_cq(bktid, 4);
+	if (-1 == bktid || -1 == cq) {
+		return 1;
+	}
+	for (i = 1; i <= 10; i++) {
+		add_timer_cq(cq, tick, (void *)(long)i, 0);
+	}
+
+	struct pollfd pfd = {timer_cq_fd(cq), POLLIN, 0};
+	nfail += check("cq fd idle", poll(&pfd, 1, 0), 0);
+	nfail += check("delivered to full ring", bucket_advance(bktid, tick), 4);
+	nfail += check("cq fd readable", poll(&pfd, 1, 0), 1);
+	n = drain_timer_cq(cq, cqes, 8);
+	nfail += check("drained", n, 4);
+	nfail += check("cq fd cleared", poll(&pfd, 1, 0), 0);
+	for (i = 0; i < n; i++) {
+		sum += (long)cqes[i].data;
+	}
+	for (i = 0; i < 2; i++) {
+		bucket_advance(bktid, tick);
+		n = drain_timer_cq(cq, cqes, 8);
+		while (n-- > 0) {
+			sum += (long)cqes[n].data;
+		}
+	}
+	nfail += check("data of all expiries", (int)sum, 55);
+
+	destroy_timer_bucket(bktid);
+	destroy_timer_cq(cq);
+	return nfail;
+}
+
+#define NODE_NUM		8
+
+static ltimer_node_t *g_nodes[NODE_NUM];
+static TimerID_t g_node_ids[NODE_NUM];
+static int g_node_fired;
+
+//first node fired releases every other node, all of them popped in the same batch.
+static void release_nodes_timeout(void *data)
+{
+	int i;
+	g_node_fired++;
+	for (i = 0; i < NODE_NUM; i++) {
+		if (NULL != g_nodes[i] && g_nodes[i] != data) {
+			del_timer_node(g_node_ids[i]);
+			free(g_nodes[i]);
+			g_nodes[i] = NULL;
+		}
+	}
+}
+
+static int test_expiry_batch(void)
+{
+	int i, nfail = 0;
+	struct timespec tick = {0, 1000000};
+
+	printf("---- expiry batch ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vbatch", 2000, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+	for (i = 0; i < NODE_NUM; i++) {
+		g_nodes[i] = (ltimer_node_t *)calloc(1, sizeof(ltimer_node_t));
+		g_node_ids[i] = add_timer_node(bktid, g_nodes[i], tick, release_nodes_timeout, g_nodes[i]);
+	}
+	memset(g_fired, 0, sizeof(g_fired));
+	for (i = 0; i < 1000; i++) {
+		add_timer(bktid, tick, count_timeout, (void *)&g_fired[i & 3], LTIMER_F_PREFETCH_DATA);
+	}
+	nfail += check("batch fired", bucket_advance(bktid, tick), 1001);
+	nfail += check("released nodes fired", g_node_fired, 1);
+	nfail += check("prefetched data fired", g_fired[0] + g_fired[1] + g_fired[2] + g_fired[3], 1000);
+	nfail += check("nothing left", (int)bucket_count_expiring(bktid, tick), 0);
+	for (i = 0; i < NODE_NUM; i++) {
+		if (NULL != g_nodes[i]) {
+			del_timer_node(g_node_ids[i]);
+			free(g_nodes[i]);
+			g_nodes[i] = NULL;
+		}
+	}
+
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+#define FIFO_NUM	1000
+
+static int g_fifo_idx[FIFO_NUM];
+static int g_fifo_next, g_fifo_misorder;
+
+static void fifo_timeout(void *data)
+{
+	g_fifo_misorder += (*(int *)data != g_fifo_next++);
+}
+
+//timers of one deadline fire in order of adding on list backend, each insert stops at list tail.
+static int test_list_fifo(void)
+{
+	int i, nfail = 0;
+	struct timespec tick = {0, 1000000};
+
+	printf("---- list fifo ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vfifo", FIFO_NUM, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+	for (i = 0; i < FIFO_NUM; i++) {
+		g_fifo_idx[i] = i;
+		add_timer(bktid, tick, fifo_timeout, &g_fifo_idx[i], 0);
+	}
+	nfail += check("same deadline fired", bucket_advance(bktid, tick), FIFO_NUM);
+	nfail += check("fired out of add order", g_fifo_misorder, 0);
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+static int g_aged, g_aged_odd;
+
+static void age_out(unsigned int idx, void *data)
+{
+	g_aged++;
+	g_aged_odd += idx & 1;
+}
+
+static int test_ager(void)
+{
+	unsigned int i;
+	int nfail = 0;
+	struct timespec tick = {0, 1000000};
+	struct timespec epoch = {0, 10000000};
+	struct timespec half = {0, 5000000};
+
+	printf("---- epoch aging ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vager", 16, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	AgerID_t ager = create_ager(bktid, 100000, epoch, 3, age_out, NULL);
+	if (-1 == bktid || -1 == ager) {
+		return 1;
+	}
+	for (i = 0; i < 100000; i++) {
+		ager_arm(ager, i);
+	}
+	ager_disarm(ager, 1);
+	bucket_advance(bktid, epoch);
+	bucket_advance(bktid, half);
+	for (i = 0; i < 100000; i += 2) {
+		ager_arm(ager, i);
+	}
+	bucket_advance(bktid, half);
+	nfail += check("none aged in window", g_aged, 0);
+	bucket_advance(bktid, epoch);
+	nfail += check("stale entries aged", g_aged, 49999);
+	nfail += check("only stale entries aged", g_aged_odd, 49999);
+	bucket_advance(bktid, epoch);
+	nfail += check("refreshed entries aged", g_aged, 99999);
+	bucket_advance(bktid, epoch);
+	bucket_advance(bktid, epoch);
+	nfail += check("aged once", g_aged, 99999);
+
+	destroy_ager(ager);
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+//budget bounds a tick, expired timers left over fire on re-loops before clock moves on.
+static int test_budget(void)
+{
+	int i, nfail = 0;
+	struct timespec now;
+	struct timespec tick = {0, 1000000};
+	struct timespec t3 = {0, 3000000};
+	struct timespec unset = {0, 0};
+
+	printf("---- budget ----\n");
+	TimerBucketID_t bktid = create_timer_bucket_ex("vbudget", 100, BUCKET_CPUID, tick, LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return 1;
+	}
+	nfail += check("set budget", bucket_set_budget(bktid, 10, unset), 0);
+	g_fired[0] = 0;
+	for (i = 0; i < 25; i++) {
+		add_timer(bktid, tick, count_timeout, &g_fired[0], 0);
+	}
+	add_timer(bktid, t3, count_timeout, &g_fired[0], 0);
+
+	nfail += check("fired in budget", bucket_advance(bktid, t3), 10);
+	nfail += check("clock stops at left over", (int)bucket_curtime(bktid, &now)->tv_nsec, 1000000);
+	nfail += check("re-loop fired in budget", bucket_advance(bktid, unset), 10);
+	nfail += check("clock stays on re-loop", (int)bucket_curtime(bktid, &now)->tv_nsec, 1000000);
+	nfail += check("left over and carried time", bucket_advance(bktid, unset), 6);
+	nfail += check("clock caught up", (int)bucket_curtime(bktid, &now)->tv_nsec, 3000000);
+	nfail += check("budget fired all", g_fired[0], 26);
+	destroy_timer_bucket(bktid);
+	return nfail;
+}
+
+int main()
+{
+	int nfail = 0;
+
+	nfail += run_test("list", 0, 0);
+	nfail += run_test("heap", LTIMER_BKT_F_HEAP, 1);
+	nfail += run_test("wheel", LTIMER_BKT_F_WHEEL, 1);
+	nfail += test_spread();
+	nfail += test_cq();
+	nfail += test_expiry_batch();
+	nfail += test_list_fifo();
+	nfail += test_ager();
+	nfail += test_budget();
+
+	printf("test_vclock %s!\n", nfail ? "failed" : "passed");
+	return nfail ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ltimer.h"
+
+//ltimer-bench: bulk expiry on a virtual bucket.
+//every timer expires on the same tick, data of each points to a flow entry in random order
+//spread over a table much larger than cache, as flow table aging does.
+//the same load is fired with and without LTIMER_F_PREFETCH_DATA.
+//the flow table has to outgrow last level cache to show anything, raise -n on big cache machines.
+
+typedef struct st_flow {
+	uint64_t			hits;			//touched by callback.
+	char				pad[56];		//rest of cache line.
+} flow_t;
+
+static const struct {
+	const char *name;
+	int flags;
+} g_backends[] = {
+	{"list", 0},
+	{"heap", LTIMER_BKT_F_HEAP},
+	{"wheel", LTIMER_BKT_F_WHEEL},
+};
+
+static void flow_timeout(void *data)
+{
+	((flow_t *)data)->hits++;
+}
+
+static int64_t elapsed_ns(struct timespec *p_begin, struct timespec *p_end)
+{
+	return (int64_t)(p_end->tv_sec - p_begin->tv_sec) * 1000000000 + (p_end->tv_nsec - p_begin->tv_nsec);
+}
+
+//@return: -1 on error, ns spent firing all timers on success.
+static int64_t run_round(int flags, int count, flow_t *flows, int *order, int type)
+{
+	int i, nfired;
+	struct timespec begin, end;
+	struct timespec tick = {0, 1000000};
+	TimerBucketID_t bktid = create_timer_bucket_ex("bench", count, 0, tick, flags | LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		if (-1 == add_timer(bktid, tick, flow_timeout, &flows[order[i]], type)) {
+			destroy_timer_bucket(bktid);
+			return -1;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	nfired = bucket_advance(bktid, tick);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	destroy_timer_bucket(bktid);
+	return (nfired == count) ? elapsed_ns(&begin, &end) : -1;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-b backend] [-n timers] [-r rounds]\n", prog);
+	printf("backends:");
+	for (size_t i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+		printf(" %s", g_backends[i].name);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int i, opt, flags = -1, count = 4000000, rounds = 3;
+	const char *backend = "list";
+
+	while (-1 != (opt = getopt(argc, argv, "b:n:r:h"))) {
+		switch (opt) {
+		case 'b':
+			backend = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	for (size_t j = 0; j < sizeof(g_backends) / sizeof(g_backends[0]); j++) {
+		if (0 == strcmp(backend, g_backends[j].name)) {
+			flags = g_backends[j].flags;
+		}
+	}
+	if (-1 == flags || count <= 0 || rounds <= 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	flow_t *flows = (flow_t *)calloc(sizeof(flow_t), count);
+	int *order = (int *)malloc(sizeof(int) * count);
+	if (NULL == flows || NULL == order) {
+		printf("out of memory!\n");
+		return EXIT_FAILURE;
+	}
+	//shuffle flows, so callbacks hit the table at random.
+	srand(1);
+	for (i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	for (i = count - 1; i > 0; i--) {
+		int j = (int)(((uint64_t)rand() * RAND_MAX + rand()) % (i + 1));
+		int tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	//rounds alternate so both modes see the same machine state, best round is kept.
+	int64_t best[2] = {INT64_MAX, INT64_MAX};
+	static const int types[2] = {0, LTIMER_F_PREFETCH_DATA};
+	for (i = 0; i < rounds * 2; i++) {
+		int64_t ns = run_round(flags, count, flows, order, types[i & 1]);
+		if (ns < 0) {
+			printf("round %d failed!\n", i);
+			return EXIT_FAILURE;
+		}
+		if (ns < best[i & 1]) {
+			best[i & 1] = ns;
+		}
+	}
+
+	printf("backend %s, %d timers, %d flow table bytes, best of %d rounds\n",
+		   backend, count, (int)(sizeof(flow_t) * count), rounds);
+	printf("  plain:         %8.1f ms, %6.1f ns/timer\n", best[0] / 1e6, (double)best[0] / count);
+	printf("  prefetch data: %8.1f ms, %6.1f ns/timer\n", best[1] / 1e6, (double)best[1] / count);
+	printf("  speedup:       %8.2fx\n", (double)best[0] / best[1]);
+
+	free(flows);
+	free(order);
+	return 0;
+}
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ltimer.h"
+#include "recorder.h"
+#include "simd.h"
+
+//ltimer-replay: replay a trace captured by bucket_record_start on a virtual bucket at full speed.
+//recorded handles are mapped to handles of the replay bucket, expire records are only counted
+//and compared with timers fired during replay.
+
+typedef struct st_handle_map {
+	uint64_t*			keys;			//recorded handles, 0 for empty.
+	TimerID_t*			vals;			//replay handles.
+	int*				types;			//timer types.
+	uint64_t			mask;			//table size - 1.
+} handle_map_t;
+
+static const struct {
+	const char *name;
+	int flags;
+} g_backends[] = {
+	{"list", 0},
+	{"heap", LTIMER_BKT_F_HEAP},
+	{"wheel", LTIMER_BKT_F_WHEEL},
+};
+
+static long g_fired;
+
+static void count_timeout(void *data)
+{
+	(*(long *)data)++;
+}
+
+static int map_init(handle_map_t *p_map, uint64_t nadds)
+{
+	uint64_t size = 1024;
+	while (size < nadds * 2) {
+		size <<= 1;
+	}
+	p_map->keys = (uint64_t *)calloc(sizeof(uint64_t), size);
+	p_map->vals = (TimerID_t *)calloc(sizeof(TimerID_t), size);
+	p_map->types = (int *)calloc(sizeof(int), size);
+	p_map->mask = size - 1;
+	return (NULL == p_map->keys || NULL == p_map->vals || NULL == p_map->types) ? -1 : 0;
+}
+
+//@return: slot of handle, or the empty slot it would go to.
+static uint64_t map_slot(handle_map_t *p_map, uint64_t key)
+{
+	uint64_t i = (key * 0x9e3779b97f4a7c15ULL) >> 20;
+	while (0 != p_map->keys[i & p_map->mask] && key != p_map->keys[i & p_map->mask]) {
+		i++;
+	}
+	return (i & p_map->mask);
+}
+
+//backward shift deletion keeps linear probing chains intact.
+static void map_erase(handle_map_t *p_map, uint64_t slot)
+{
+	uint64_t i = slot, j = slot, home;
+	for (;;) {
+		p_map->keys[i] = 0;
+		for (;;) {
+			j = (j + 1) & p_map->mask;
+			if (0 == p_map->keys[j]) {
+				return;
+			}
+			home = ((p_map->keys[j] * 0x9e3779b97f4a7c15ULL) >> 20) & p_map->mask;
+			if (((j - home) & p_map->mask) >= ((j - i) & p_map->mask)) {
+				break;
+			}
+		}
+		p_map->keys[i] = p_map->keys[j];
+		p_map->vals[i] = p_map->vals[j];
+		p_map->types[i] = p_map->types[j];
+		i = j;
+	}
+}
+
+static struct timespec ns_to_timespec(int64_t ns)
+{
+	struct timespec ts;
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	return ts;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-b backend] trace_file\n", prog);
+	printf("backends:");
+	for (size_t i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+		printf(" %s", g_backends[i].name);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, flags = -1;
+	const char *backend = "list";
+
+	while (-1 != (opt = getopt(argc, argv, "b:h"))) {
+		switch (opt) {
+		case 'b':
+			backend = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+		if (0 == strcmp(backend, g_backends[i].name)) {
+			flags = g_backends[i].flags;
+		}
+	}
+	if (-1 == flags) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//load whole trace, replay should measure the timer bucket, not file io.
+	int readlen = 0;
+	FILE *fp = fopen(argv[optind], "rb");
+	if (NULL == fp) {
+		printf("open trace [%s] failed!\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	fseek(fp, 0, SEEK_END);
+	long flen = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	char *content = (char *)malloc(flen > 0 ? flen : 1);
+	if (NULL == content) {
+		fclose(fp);
+		return EXIT_FAILURE;
+	}
+	readlen = fread(content, 1, flen, fp);
+	fclose(fp);
+
+	ltimer_trace_hdr_t *p_hdr = (ltimer_trace_hdr_t *)content;
+	if (readlen < (int)sizeof(ltimer_trace_hdr_t) || LTIMER_TRACE_MAGIC != p_hdr->magic || p_hdr->resolution <= 0) {
+		printf("invalid trace [%s]!\n", argv[optind]);
+		free(content);
+		return EXIT_FAILURE;
+	}
+	ltimer_record_t *p_recs = (ltimer_record_t *)(content + sizeof(ltimer_trace_hdr_t));
+	uint64_t i, nrecs = (readlen - sizeof(ltimer_trace_hdr_t)) / sizeof(ltimer_record_t);
+	uint64_t nadds = 0, nexpires = 0;
+	for (i = 0; i < nrecs; i++) {
+		nadds += (EN_LTIMER_REC_ADD == p_recs[i].op);
+	}
+
+	handle_map_t map;
+	if (0 != map_init(&map, nadds)) {
+		printf("alloc handle map failed!\n");
+		return EXIT_FAILURE;
+	}
+
+	TimerBucketID_t bktid = create_timer_bucket_ex("replay", nadds > 0 ? nadds : 1, 0,
+			ns_to_timespec(p_hdr->resolution), flags | LTIMER_BKT_F_VIRTUAL);
+	if (-1 == bktid) {
+		return EXIT_FAILURE;
+	}
+
+	struct timespec begin, end;
+	int64_t vnow = (nrecs > 0) ? p_recs[0].ts : 0;
+	uint64_t slot, nops = 0, nfailed = 0;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	for (i = 0; i < nrecs; i++) {
+		ltimer_record_t *p = &p_recs[i];
+		if (p->ts > vnow) {
+			bucket_advance(bktid, ns_to_timespec(p->ts - vnow));
+			vnow = p->ts;
+		}
+
+		slot = map_slot(&map, p->handle);
+		switch (p->op) {
+		case EN_LTIMER_REC_ADD: {
+			TimerID_t id = add_timer(bktid, ns_to_timespec(p->period), count_timeout, &g_fired, p->type);
+			if (-1 == id) {
+				nfailed++;
+				break;
+			}
+			map.keys[slot] = p->handle;
+			map.vals[slot] = id;
+			map.types[slot] = p->type;
+			nops++;
+			break;
+		}
+		case EN_LTIMER_REC_MOD: {
+			if (0 == map.keys[slot]) {
+				nfailed++;
+				break;
+			}
+			struct timespec tm = ns_to_timespec(p->period);
+			mod_timer(map.vals[slot], tm, NULL, NULL);
+			nops++;
+			break;
+		}
+		case EN_LTIMER_REC_DEL: {
+			if (0 == map.keys[slot]) {
+				nfailed++;
+				break;
+			}
+			del_timer(map.vals[slot]);
+			map_erase(&map, slot);
+			nops++;
+			break;
+		}
+		case EN_LTIMER_REC_EXPIRE: {
+			//once timer handle is released when it fires.
+			nexpires++;
+			if (0 != map.keys[slot] && 0 == (map.types[slot] & ~LTIMER_TYPE_FLAGS)) {
+				map_erase(&map, slot);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double secs = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+	int64_t span = (nrecs > 0) ? p_recs[nrecs - 1].ts - p_recs[0].ts : 0;
+
+	printf("backend:         %s (scan kernel %s)\n", backend, simd_kernel_name());
+	printf("records:         %lu\n", (unsigned long)nrecs);
+	printf("ops replayed:    %lu (%lu unmatched)\n", (unsigned long)nops, (unsigned long)nfailed);
+	printf("expires:         recorded %lu, replayed %ld\n", (unsigned long)nexpires, g_fired);
+	printf("traffic span:    %.3f s\n", span / 1e9);
+	printf("replay time:     %.3f s\n", secs);
+	printf("ops per second:  %.0f\n", secs > 0 ? (nops + g_fired) / secs : 0.0);
+
+	destroy_timer_bucket(bktid);
+	free(map.keys);
+	free(map.vals);
+	free(map.types);
+	free(content);
+	return 0;
+}